@@ -7,54 +7,184 @@
  *      /boot/System.map-$(uname -r)
  *   falling back to:
  *      /proc/kallsyms
+ *   both resolved in a single pass per file (ksym_lookup())
  *
- * - Dynamic kernel memory from /proc/meminfo:
+ * - Dynamic kernel memory from one snapshot of /proc/meminfo:
  *      Slab, PageTables, VmallocUsed, KernelStack
  *
- * - Module memory from /proc/modules
+ * - Module memory from /proc/modules, per module from /sys/module (--modules)
+ *
+ * - With --slab, per-cache memory from /proc/slabinfo or /sys/kernel/slab
+ *
+ * - With --numa, the same per node from /sys/devices/system/node
+ *
+ * - With --vmalloc, vmalloc areas by caller and type from /proc/vmallocinfo
+ *
+ * - With --alloc-sites, live bytes per allocation call site from
+ *   /proc/allocinfo (CONFIG_MEM_ALLOC_PROFILING)
+ *
+ * - With --census, every physical page classified from /proc/kpageflags
+ *
+ * - With --frag, buddy allocator fragmentation from /proc/buddyinfo and
+ *   /proc/pagetypeinfo
+ *
+ * - With --watch, deltas, rates, trends and leak suspects over time
  *
  * Build:
- *     gcc -O2 -o kernmem kernelmem3.c
+ *     gcc -O2 -pthread -o kernmem kernmem.c
  *
  * Run:
- *     ./kernmem
+ *     ./kernmem [--json] [--slab] [--modules] [--numa] [--vmalloc] [--alloc-sites]
+ *               [--census] [--frag] [--top N]
+ *     ./kernmem --watch SECS [--count N] [--leak-window N] [--alloc-sites] [--frag]
  *
  * Author: Jerry Richardson <jerry@jerryslab.com>
  * Copyright (C) 2025
  *
  */
 
+#define _GNU_SOURCE
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <ctype.h>
+#include <errno.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <getopt.h>
+#include <dirent.h>
+#include <limits.h>
+#include <time.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <ftw.h>
 #include <sys/utsname.h>
+#include <sys/stat.h>
 
 #define KALLSYMS_PATH "/proc/kallsyms"
 #define MEMINFO_PATH  "/proc/meminfo"
 #define MODULES_PATH  "/proc/modules"
 
-/* ---------- Symbol lookup helpers ---------- */
+/* ---------- Symbol lookup ---------- */
 
-static unsigned long long get_symbol_from_file(FILE *f, const char *name) {
-    char sym_name[256];
-    char type;
-    unsigned long long addr;
+/*
+ * One pass over a System.map or /proc/kallsyms style file ("addr type name
+ * [module]") resolves any number of symbols.  The file is read in large
+ * chunks, each name is checked against a sorted table of the wanted ones
+ * (after a cheap first-byte/length filter), and reading stops as soon as
+ * every symbol has been found.
+ */
+#define KSYM_CHUNK (1 << 20)
+
+typedef struct {
+    const char *name;           /* symbol to resolve */
+    unsigned long long addr;    /* 0 until found */
+    int found;
+} ksym_t;
+
+static int ksym_cmp(const void *a, const void *b) {
+    return strcmp(((const ksym_t *)a)->name, ((const ksym_t *)b)->name);
+}
+
+/* Look up name[0..len) in the sorted table */
+static ksym_t *ksym_find(ksym_t *syms, size_t n, const char *name, size_t len) {
+    size_t lo = 0, hi = n;
+    while (lo < hi) {
+        size_t mid = (lo + hi) / 2;
+        int c = strncmp(syms[mid].name, name, len);
+        if (c == 0 && syms[mid].name[len] != '\0')
+            c = 1;
+        if (c == 0)
+            return &syms[mid];
+        if (c < 0)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return NULL;
+}
 
-    rewind(f);
-    while (fscanf(f, "%llx %c %255s", &addr, &type, sym_name) == 3) {
-        if (strcmp(sym_name, name) == 0) {
-            return addr;
+/*
+ * Resolve syms[] from path in a single pass.  The table is sorted by name
+ * in place.  Symbols listed with address 0 (kptr_restrict) count as not
+ * found.  Returns the number found, or -1 if path cannot be opened.
+ */
+static int ksym_lookup(const char *path, ksym_t *syms, size_t n) {
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+        return -1;
+
+    unsigned char first[256] = {0};
+    size_t minlen = (size_t)-1, maxlen = 0;
+    for (size_t i = 0; i < n; i++) {
+        size_t len = strlen(syms[i].name);
+        syms[i].addr = 0;
+        syms[i].found = 0;
+        first[(unsigned char)syms[i].name[0]] = 1;
+        if (len < minlen) minlen = len;
+        if (len > maxlen) maxlen = len;
+    }
+    qsort(syms, n, sizeof(*syms), ksym_cmp);
+
+    char *buf = malloc(KSYM_CHUNK + 1);
+    if (!buf) {
+        close(fd);
+        return -1;
+    }
+
+    size_t have = 0;    /* bytes of a partial line carried over */
+    size_t left = n;
+    ssize_t r;
+    while (left > 0 && (r = read(fd, buf + have, KSYM_CHUNK - have)) > 0) {
+        size_t end = have + (size_t)r;
+        char *p = buf;
+        char *lim = buf + end;
+        for (;;) {
+            char *nl = memchr(p, '\n', (size_t)(lim - p));
+            if (!nl)
+                break;
+
+            /* addr, type, name: skip the address and type columns */
+            char *name = memchr(p, ' ', (size_t)(nl - p));
+            if (name && nl - name > 3) {
+                name += 3;
+                char *e = name;
+                while (e < nl && *e != ' ' && *e != '\t')
+                    e++;
+                size_t len = (size_t)(e - name);
+                if (first[(unsigned char)*name] && len >= minlen && len <= maxlen) {
+                    ksym_t *s = ksym_find(syms, n, name, len);
+                    if (s && !s->found) {
+                        s->addr = strtoull(p, NULL, 16);
+                        if (s->addr != 0) {
+                            s->found = 1;
+                            left--;
+                        }
+                    }
+                }
+            }
+            p = nl + 1;
         }
+
+        /* Keep the incomplete tail; a single over-long line is dropped */
+        have = (size_t)(lim - p);
+        if (have == KSYM_CHUNK)
+            have = 0;
+        memmove(buf, p, have);
     }
-    return 0;
+
+    free(buf);
+    close(fd);
+    return (int)(n - left);
 }
 
-static unsigned long long get_symbol_from_path(const char *path, const char *name) {
-    FILE *f = fopen(path, "r");
-    if (!f) return 0;
-    unsigned long long addr = get_symbol_from_file(f, name);
-    fclose(f);
-    return addr;
+/* Address of a resolved symbol in a table from ksym_lookup(), 0 if absent */
+static unsigned long long ksym_addr(const ksym_t *syms, size_t n, const char *name) {
+    for (size_t i = 0; i < n; i++) {
+        if (syms[i].found && strcmp(syms[i].name, name) == 0)
+            return syms[i].addr;
+    }
+    return 0;
 }
 
 /* Read .text/.data/.bss sizes in kB using System.map, fallback to kallsyms */
@@ -73,48 +203,27 @@ static int get_static_sections_kb(unsigned long long *text_kb,
         sysmap_path[0] = '\0';
     }
 
-    unsigned long long _text = 0, _etext = 0;
-    unsigned long long _sdata = 0, _edata = 0;
-    unsigned long long _bss_start = 0, _bss_stop = 0;
+    ksym_t syms[] = {
+        { "_text", 0, 0 },       { "_etext", 0, 0 },
+        { "_sdata", 0, 0 },      { "_edata", 0, 0 },
+        { "__bss_start", 0, 0 }, { "__bss_stop", 0, 0 },
+    };
+    size_t n = sizeof(syms) / sizeof(syms[0]);
 
-    /* 1) Try System.map-<release> */
-    if (sysmap_path[0]) {
-        FILE *f = fopen(sysmap_path, "r");
-        if (f) {
-            char sym_name[256];
-            char type;
-            unsigned long long addr;
-
-            while (fscanf(f, "%llx %c %255s", &addr, &type, sym_name) == 3) {
-                if (strcmp(sym_name, "_text") == 0)         _text = addr;
-                else if (strcmp(sym_name, "_etext") == 0)   _etext = addr;
-                else if (strcmp(sym_name, "_sdata") == 0)   _sdata = addr;
-                else if (strcmp(sym_name, "_edata") == 0)   _edata = addr;
-                else if (strcmp(sym_name, "__bss_start") == 0) _bss_start = addr;
-                else if (strcmp(sym_name, "__bss_stop") == 0)  _bss_stop = addr;
-            }
-            fclose(f);
+    /* 1) Try System.map-<release>, 2) then kallsyms */
+    if (!sysmap_path[0] || ksym_lookup(sysmap_path, syms, n) != (int)n) {
+        if (ksym_lookup(KALLSYMS_PATH, syms, n) != (int)n) {
+            /* Can't get reliable static section sizes */
+            return -1;
         }
     }
 
-    /* If we didn't find them in System.map, try kallsyms */
-    if (_text == 0 || _etext == 0 || _sdata == 0 || _edata == 0 ||
-        _bss_start == 0 || _bss_stop == 0) {
-
-        _text      = get_symbol_from_path(KALLSYMS_PATH, "_text");
-        _etext     = get_symbol_from_path(KALLSYMS_PATH, "_etext");
-        _sdata     = get_symbol_from_path(KALLSYMS_PATH, "_sdata");
-        _edata     = get_symbol_from_path(KALLSYMS_PATH, "_edata");
-        _bss_start = get_symbol_from_path(KALLSYMS_PATH, "__bss_start");
-        _bss_stop  = get_symbol_from_path(KALLSYMS_PATH, "__bss_stop");
-    }
-
-    if (_text == 0 || _etext == 0 ||
-        _sdata == 0 || _edata == 0 ||
-        _bss_start == 0 || _bss_stop == 0) {
-        /* Can't get reliable static section sizes */
-        return -1;
-    }
+    unsigned long long _text      = ksym_addr(syms, n, "_text");
+    unsigned long long _etext     = ksym_addr(syms, n, "_etext");
+    unsigned long long _sdata     = ksym_addr(syms, n, "_sdata");
+    unsigned long long _edata     = ksym_addr(syms, n, "_edata");
+    unsigned long long _bss_start = ksym_addr(syms, n, "__bss_start");
+    unsigned long long _bss_stop  = ksym_addr(syms, n, "__bss_stop");
 
     *text_kb = (_etext - _text) / 1024;
     *data_kb = (_edata - _sdata) / 1024;
@@ -124,22 +233,338 @@ static int get_static_sections_kb(unsigned long long *text_kb,
 
 /* ---------- /proc helpers ---------- */
 
-static long read_meminfo_kb(const char *key) {
-    FILE *f = fopen(MEMINFO_PATH, "r");
-    if (!f) return -1;
-
-    char line[256];
-    long val = -1;
+#define VMALLOCINFO_PATH "/proc/vmallocinfo"
 
-    while (fgets(line, sizeof(line), f)) {
-        if (strncmp(line, key, strlen(key)) == 0) {
-            sscanf(line + strlen(key), " %ld kB", &val);
+/*
+ * Read a whole (proc/sys) file from offset 0 with pread() into *buf,
+ * growing it as needed.  Works on a descriptor that is kept open and
+ * re-read.  Returns the length (NUL-terminated), or -1.
+ */
+static ssize_t pread_all(int fd, char **buf, size_t *cap) {
+    size_t len = 0;
+    for (;;) {
+        if (*cap - len < 4096 + 1) {
+            size_t ncap = *cap ? *cap * 2 : 16384;
+            char *nb = realloc(*buf, ncap);
+            if (!nb)
+                return -1;
+            *buf = nb;
+            *cap = ncap;
+        }
+        ssize_t r = pread(fd, *buf + len, *cap - len - 1, (off_t)len);
+        if (r < 0)
+            return -1;
+        if (r == 0)
             break;
+        len += (size_t)r;
+    }
+    (*buf)[len] = '\0';
+    return (ssize_t)len;
+}
+
+/* Open and read a whole file; caller frees.  NULL on error */
+static char *read_whole(const char *path) {
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+        return NULL;
+    char *buf = NULL;
+    size_t cap = 0;
+    ssize_t n = pread_all(fd, &buf, &cap);
+    close(fd);
+    if (n < 0) {
+        free(buf);
+        return NULL;
+    }
+    return buf;
+}
+
+/* ---------- Keyed aggregation ---------- */
+
+/*
+ * Open-addressing hash table of name -> (bytes, units, count), used to sum
+ * per-line records of vmallocinfo and allocinfo by caller, file, module...
+ * agg_sort() packs and orders the slots, after which the table can only
+ * be read as an array.
+ */
+typedef struct {
+    char key[128];                 /* "" = empty slot */
+    unsigned long long bytes;
+    unsigned long long units;      /* pages, calls... */
+    long n;                        /* records folded in */
+} agg_entry_t;
+
+typedef struct {
+    agg_entry_t *slot;
+    size_t cap;                    /* power of two */
+    size_t n;
+} agg_t;
+
+static uint32_t fnv1a(const char *s, size_t len) {
+    uint32_t h = 2166136261u;
+    for (size_t i = 0; i < len; i++) {
+        h ^= (unsigned char)s[i];
+        h *= 16777619u;
+    }
+    return h;
+}
+
+static int agg_grow(agg_t *a) {
+    size_t ncap = a->cap ? a->cap * 2 : 1024;
+    agg_entry_t *ns = calloc(ncap, sizeof(*ns));
+    if (!ns)
+        return -1;
+    for (size_t i = 0; i < a->cap; i++) {
+        if (!a->slot[i].key[0])
+            continue;
+        size_t k = fnv1a(a->slot[i].key, strlen(a->slot[i].key)) & (ncap - 1);
+        while (ns[k].key[0])
+            k = (k + 1) & (ncap - 1);
+        ns[k] = a->slot[i];
+    }
+    free(a->slot);
+    a->slot = ns;
+    a->cap = ncap;
+    return 0;
+}
+
+/* Slot for key[0..len), NULL if absent (or with create, out of memory) */
+static agg_entry_t *agg_get(agg_t *a, const char *key, size_t len, int create) {
+    if (len >= sizeof(a->slot[0].key))
+        len = sizeof(a->slot[0].key) - 1;
+    if (len == 0)
+        return NULL;
+    if (create && (a->n + 1) * 4 > a->cap * 3 && agg_grow(a) != 0)
+        return NULL;
+    if (a->cap == 0)
+        return NULL;
+    size_t k = fnv1a(key, len) & (a->cap - 1);
+    while (a->slot[k].key[0]) {
+        if (strncmp(a->slot[k].key, key, len) == 0 && a->slot[k].key[len] == '\0')
+            return &a->slot[k];
+        k = (k + 1) & (a->cap - 1);
+    }
+    if (!create)
+        return NULL;
+    memcpy(a->slot[k].key, key, len);
+    a->slot[k].key[len] = '\0';
+    a->n++;
+    return &a->slot[k];
+}
+
+static void agg_add(agg_t *a, const char *key, size_t len,
+                    unsigned long long bytes, unsigned long long units) {
+    agg_entry_t *e = agg_get(a, key, len, 1);
+    if (e) {
+        e->bytes += bytes;
+        e->units += units;
+        e->n++;
+    }
+}
+
+static int agg_cmp_bytes(const void *x, const void *y) {
+    const agg_entry_t *a = x, *b = y;
+    return (a->bytes < b->bytes) - (a->bytes > b->bytes);
+}
+
+/* Pack the used slots to the front and sort them by bytes, largest first */
+static void agg_sort(agg_t *a) {
+    size_t j = 0;
+    for (size_t i = 0; i < a->cap; i++) {
+        if (a->slot[i].key[0])
+            a->slot[j++] = a->slot[i];
+    }
+    qsort(a->slot, j, sizeof(a->slot[0]), agg_cmp_bytes);
+}
+
+static void agg_free(agg_t *a) {
+    free(a->slot);
+    memset(a, 0, sizeof(*a));
+}
+
+static long kb_or_zero(long kb) {
+    return kb > 0 ? kb : 0;
+}
+
+/* ---------- /proc/meminfo snapshot ---------- */
+
+/*
+ * The whole of /proc/meminfo is read once and parsed into a snapshot, so
+ * every figure kernmem prints comes from the same moment.  Known fields
+ * are indexed through mi_keys[]; every line, known or not, is also kept
+ * in file order for --json.
+ */
+enum {
+    MI_MEM_TOTAL, MI_MEM_FREE, MI_MEM_AVAILABLE, MI_BUFFERS, MI_CACHED,
+    MI_SWAP_CACHED, MI_ACTIVE, MI_INACTIVE, MI_ACTIVE_ANON, MI_INACTIVE_ANON,
+    MI_ACTIVE_FILE, MI_INACTIVE_FILE, MI_UNEVICTABLE, MI_MLOCKED,
+    MI_SWAP_TOTAL, MI_SWAP_FREE, MI_ZSWAP, MI_ZSWAPPED, MI_DIRTY,
+    MI_WRITEBACK, MI_ANON_PAGES, MI_MAPPED, MI_SHMEM, MI_KRECLAIMABLE,
+    MI_SLAB, MI_SRECLAIMABLE, MI_SUNRECLAIM, MI_KERNEL_STACK,
+    MI_SHADOW_CALL_STACK, MI_PAGE_TABLES, MI_SEC_PAGE_TABLES,
+    MI_NFS_UNSTABLE, MI_BOUNCE, MI_WRITEBACK_TMP, MI_COMMIT_LIMIT,
+    MI_COMMITTED_AS, MI_VMALLOC_TOTAL, MI_VMALLOC_USED, MI_VMALLOC_CHUNK,
+    MI_PERCPU, MI_HARDWARE_CORRUPTED, MI_ANON_HUGE_PAGES,
+    MI_SHMEM_HUGE_PAGES, MI_SHMEM_PMD_MAPPED, MI_FILE_HUGE_PAGES,
+    MI_FILE_PMD_MAPPED, MI_CMA_TOTAL, MI_CMA_FREE, MI_UNACCEPTED,
+    MI_BALLOON, MI_HUGE_PAGES_TOTAL, MI_HUGE_PAGES_FREE, MI_HUGE_PAGES_RSVD,
+    MI_HUGE_PAGES_SURP, MI_HUGEPAGESIZE, MI_HUGETLB, MI_DIRECT_MAP_4K,
+    MI_DIRECT_MAP_2M, MI_DIRECT_MAP_1G,
+    MI_NFIELDS
+};
+
+typedef struct {
+    const char *name;
+    int idx;
+} mi_key_t;
+
+static mi_key_t mi_keys[] = {
+    { "MemTotal", MI_MEM_TOTAL },             { "MemFree", MI_MEM_FREE },
+    { "MemAvailable", MI_MEM_AVAILABLE },     { "Buffers", MI_BUFFERS },
+    { "Cached", MI_CACHED },                  { "SwapCached", MI_SWAP_CACHED },
+    { "Active", MI_ACTIVE },                  { "Inactive", MI_INACTIVE },
+    { "Active(anon)", MI_ACTIVE_ANON },       { "Inactive(anon)", MI_INACTIVE_ANON },
+    { "Active(file)", MI_ACTIVE_FILE },       { "Inactive(file)", MI_INACTIVE_FILE },
+    { "Unevictable", MI_UNEVICTABLE },        { "Mlocked", MI_MLOCKED },
+    { "SwapTotal", MI_SWAP_TOTAL },           { "SwapFree", MI_SWAP_FREE },
+    { "Zswap", MI_ZSWAP },                    { "Zswapped", MI_ZSWAPPED },
+    { "Dirty", MI_DIRTY },                    { "Writeback", MI_WRITEBACK },
+    { "AnonPages", MI_ANON_PAGES },           { "Mapped", MI_MAPPED },
+    { "Shmem", MI_SHMEM },                    { "KReclaimable", MI_KRECLAIMABLE },
+    { "Slab", MI_SLAB },                      { "SReclaimable", MI_SRECLAIMABLE },
+    { "SUnreclaim", MI_SUNRECLAIM },          { "KernelStack", MI_KERNEL_STACK },
+    { "ShadowCallStack", MI_SHADOW_CALL_STACK }, { "PageTables", MI_PAGE_TABLES },
+    { "SecPageTables", MI_SEC_PAGE_TABLES },  { "NFS_Unstable", MI_NFS_UNSTABLE },
+    { "Bounce", MI_BOUNCE },                  { "WritebackTmp", MI_WRITEBACK_TMP },
+    { "CommitLimit", MI_COMMIT_LIMIT },       { "Committed_AS", MI_COMMITTED_AS },
+    { "VmallocTotal", MI_VMALLOC_TOTAL },     { "VmallocUsed", MI_VMALLOC_USED },
+    { "VmallocChunk", MI_VMALLOC_CHUNK },     { "Percpu", MI_PERCPU },
+    { "HardwareCorrupted", MI_HARDWARE_CORRUPTED },
+    { "AnonHugePages", MI_ANON_HUGE_PAGES },  { "ShmemHugePages", MI_SHMEM_HUGE_PAGES },
+    { "ShmemPmdMapped", MI_SHMEM_PMD_MAPPED }, { "FileHugePages", MI_FILE_HUGE_PAGES },
+    { "FilePmdMapped", MI_FILE_PMD_MAPPED },  { "CmaTotal", MI_CMA_TOTAL },
+    { "CmaFree", MI_CMA_FREE },               { "Unaccepted", MI_UNACCEPTED },
+    { "Balloon", MI_BALLOON },                { "HugePages_Total", MI_HUGE_PAGES_TOTAL },
+    { "HugePages_Free", MI_HUGE_PAGES_FREE }, { "HugePages_Rsvd", MI_HUGE_PAGES_RSVD },
+    { "HugePages_Surp", MI_HUGE_PAGES_SURP }, { "Hugepagesize", MI_HUGEPAGESIZE },
+    { "Hugetlb", MI_HUGETLB },                { "DirectMap4k", MI_DIRECT_MAP_4K },
+    { "DirectMap2M", MI_DIRECT_MAP_2M },      { "DirectMap1G", MI_DIRECT_MAP_1G },
+};
+#define MI_NKEYS (sizeof(mi_keys) / sizeof(mi_keys[0]))
+
+typedef struct {
+    char name[32];
+    long val;                   /* kB, or a plain count for HugePages_* */
+} mi_field_t;
+
+typedef struct {
+    long v[MI_NFIELDS];         /* known fields, -1 when absent */
+    mi_field_t *all;            /* every line in file order, unknown ones too */
+    size_t nall;
+    size_t cap;
+} meminfo_t;
+
+static int mi_key_cmp(const void *a, const void *b) {
+    return strcmp(((const mi_key_t *)a)->name, ((const mi_key_t *)b)->name);
+}
+
+static int mi_key_index(const char *name) {
+    static int sorted;
+    if (!sorted) {
+        qsort(mi_keys, MI_NKEYS, sizeof(mi_keys[0]), mi_key_cmp);
+        sorted = 1;
+    }
+    mi_key_t key = { name, 0 };
+    mi_key_t *k = bsearch(&key, mi_keys, MI_NKEYS, sizeof(mi_keys[0]), mi_key_cmp);
+    return k ? k->idx : -1;
+}
+
+/*
+ * Parse a meminfo text buffer ("Key:   value [kB]" per line).  The
+ * "Node N " prefix of the per-node files is skipped.
+ */
+static void meminfo_parse(const char *buf, meminfo_t *m) {
+    for (int i = 0; i < MI_NFIELDS; i++)
+        m->v[i] = -1;
+    m->nall = 0;
+
+    for (const char *p = buf; *p; ) {
+        if (strncmp(p, "Node ", 5) == 0) {
+            p += 5;
+            while (isdigit((unsigned char)*p))
+                p++;
+            while (*p == ' ')
+                p++;
+        }
+        const char *nl = strchr(p, '\n');
+        const char *colon = memchr(p, ':', nl ? (size_t)(nl - p) : strlen(p));
+        if (colon && (size_t)(colon - p) < sizeof(m->all[0].name)) {
+            mi_field_t f;
+            memcpy(f.name, p, (size_t)(colon - p));
+            f.name[colon - p] = '\0';
+            f.val = strtol(colon + 1, NULL, 10);
+
+            int idx = mi_key_index(f.name);
+            if (idx >= 0)
+                m->v[idx] = f.val;
+
+            if (m->nall == m->cap) {
+                size_t ncap = m->cap ? m->cap * 2 : 64;
+                mi_field_t *na = realloc(m->all, ncap * sizeof(*na));
+                if (na) {
+                    m->all = na;
+                    m->cap = ncap;
+                }
+            }
+            if (m->nall < m->cap)
+                m->all[m->nall++] = f;
         }
+        if (!nl)
+            break;
+        p = nl + 1;
     }
+}
 
-    fclose(f);
-    return val;
+/* One read of /proc/meminfo into a snapshot */
+static int meminfo_snapshot(meminfo_t *m) {
+    char *buf = read_whole(MEMINFO_PATH);
+    if (!buf)
+        return -1;
+    meminfo_parse(buf, m);
+    free(buf);
+    return 0;
+}
+
+static void meminfo_free(meminfo_t *m) {
+    free(m->all);
+    m->all = NULL;
+    m->nall = m->cap = 0;
+}
+
+/* ---------- Modules ---------- */
+
+/* A kB figure for JSON: null when the source did not provide it */
+static void json_kb(const char *key, long kb, const char *sep) {
+    if (kb >= 0)
+        printf("\"%s\": %ld%s", key, kb, sep);
+    else
+        printf("\"%s\": null%s", key, sep);
+}
+
+/* A free-form string (cache, caller, cgroup path...) as a JSON string */
+static void json_put_str(FILE *fp, const char *s) {
+    fputc('"', fp);
+    for (; *s; s++) {
+        unsigned char c = (unsigned char)*s;
+        if (c == '"' || c == '\\')
+            fprintf(fp, "\\%c", c);
+        else if (c == '\n')
+            fputs("\\n", fp);
+        else if (c < 0x20)
+            fprintf(fp, "\\u%04x", c);
+        else
+            fputc(c, fp);
+    }
+    fputc('"', fp);
 }
 
 static long read_modules_kb(void) {
@@ -159,71 +584,3047 @@ static long read_modules_kb(void) {
     return total / 1024; /* bytes -> kB */
 }
 
-/* ---------- Main ---------- */
+/* ---------- Per-module breakdown ---------- */
+
+/*
+ * --modules reads /sys/module/<m>/ for every loaded module: coresize,
+ * initsize, refcnt, taint and the section start addresses in sections/.
+ * A section runs to the next section start or to the end of the vmalloc
+ * area holding it (/proc/vmallocinfo, less the guard page), whichever
+ * comes first; since 6.4 text, rodata and data are separate allocations,
+ * so area ends are what separate them.  Without vmallocinfo a gap larger
+ * than the core is taken to cross allocations and the section before it,
+ * like the last one, is unknown ("-").  Freed .init sections are skipped.
+ * Addresses read as 0 without root, in which case the split is unknown.
+ *
+ * All reads are relative to a /sys/module directory fd.  With many
+ * modules they are spread over a few threads.
+ */
+#define MODULE_SYSFS        "/sys/module"
+#define MODULE_THREADS      4
+#define MODULE_THREAD_MIN   64     /* modules before threads are used */
+
+typedef struct {
+    char name[64];
+    long core;                     /* bytes */
+    long init;
+    long text, rodata, data, bss;  /* bytes, -1 if unknown */
+    int  refcnt;
+    char taint[16];
+} kmod_t;
+
+typedef struct {
+    kmod_t *m;
+    size_t n;
+} kmod_list_t;
+
+typedef struct {
+    char name[64];
+    unsigned long long addr;
+} ksect_t;
+
+typedef struct {
+    unsigned long long start, end; /* usable bytes, guard page excluded */
+} kvarea_t;
+
+typedef struct {
+    kvarea_t *a;
+    size_t n;
+} kvarea_list_t;
+
+/* Small sysfs attribute of a module into buf, trimmed; -1 if missing */
+static int kmod_attr(int dfd, const char *mod, const char *attr, char *buf, size_t bufsz) {
+    char path[192];
+    snprintf(path, sizeof(path), "%s/%s", mod, attr);
+    int fd = openat(dfd, path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+        return -1;
+    ssize_t n = read(fd, buf, bufsz - 1);
+    close(fd);
+    if (n < 0)
+        return -1;
+    while (n > 0 && (buf[n - 1] == '\n' || buf[n - 1] == ' '))
+        n--;
+    buf[n] = '\0';
+    return 0;
+}
 
-int main(void) {
-    unsigned long long text_kb = 0, data_kb = 0, bss_kb = 0;
-    int static_ok = get_static_sections_kb(&text_kb, &data_kb, &bss_kb);
+static int ksect_cmp(const void *a, const void *b) {
+    const ksect_t *x = a, *y = b;
+    return (x->addr > y->addr) - (x->addr < y->addr);
+}
 
-    long slab_kb       = read_meminfo_kb("Slab:");
-    long pagetables_kb = read_meminfo_kb("PageTables:");
-    long vmalloc_kb    = read_meminfo_kb("VmallocUsed:");
-    long kstack_kb     = read_meminfo_kb("KernelStack:");
-    long modules_kb    = read_modules_kb();
+static int kvarea_cmp(const void *a, const void *b) {
+    const kvarea_t *x = a, *y = b;
+    return (x->start > y->start) - (x->start < y->start);
+}
 
-    long static_total_kb  = 0;
-    long dynamic_total_kb = 0;
-    long grand_total_kb   = 0;
+/* Every vmalloc area, sorted by start; empty if vmallocinfo is unreadable */
+static void kvarea_collect(kvarea_list_t *l) {
+    char *buf = read_whole(VMALLOCINFO_PATH);
+    if (!buf)
+        return;
+    unsigned long long page = (unsigned long long)sysconf(_SC_PAGESIZE);
+    size_t cap = 0;
+    for (char *line = buf; line && *line; ) {
+        char *nl = strchr(line, '\n');
+        unsigned long long start, end;
+        if (sscanf(line, "%llx-%llx", &start, &end) == 2 && start && end - start > page) {
+            if (l->n == cap) {
+                size_t ncap = cap ? cap * 2 : 1024;
+                kvarea_t *na = realloc(l->a, ncap * sizeof(*na));
+                if (!na)
+                    break;
+                l->a = na;
+                cap = ncap;
+            }
+            l->a[l->n++] = (kvarea_t){ start, end - page };
+        }
+        line = nl ? nl + 1 : NULL;
+    }
+    free(buf);
+    qsort(l->a, l->n, sizeof(*l->a), kvarea_cmp);
+}
 
-    if (static_ok == 0) {
-        static_total_kb = (long)(text_kb + data_kb + bss_kb);
+/* End of the area holding addr, 0 if none does */
+static unsigned long long kvarea_end(const kvarea_list_t *l, unsigned long long addr) {
+    size_t lo = 0, hi = l->n;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (l->a[mid].start <= addr)
+            lo = mid + 1;
+        else
+            hi = mid;
     }
+    return (lo > 0 && addr < l->a[lo - 1].end) ? l->a[lo - 1].end : 0;
+}
 
-    if (slab_kb       > 0) dynamic_total_kb += slab_kb;
-    if (pagetables_kb > 0) dynamic_total_kb += pagetables_kb;
-    if (vmalloc_kb    > 0) dynamic_total_kb += vmalloc_kb;
-    if (kstack_kb     > 0) dynamic_total_kb += kstack_kb;
+/* The kmod_t column a section is counted in, NULL for the rest */
+static long *ksect_column(kmod_t *m, const char *nm) {
+    if (strncmp(nm, ".text", 5) == 0 || strncmp(nm, ".exit.text", 10) == 0)
+        return &m->text;
+    if (strncmp(nm, ".rodata", 7) == 0)
+        return &m->rodata;
+    if (strncmp(nm, ".data", 5) == 0)
+        return &m->data;
+    if (strncmp(nm, ".bss", 4) == 0)
+        return &m->bss;
+    return NULL;
+}
 
-    grand_total_kb = static_total_kb + dynamic_total_kb;
-    if (modules_kb > 0)
-        grand_total_kb += modules_kb;
+/* .text/.rodata/.data/.bss split from the section start addresses */
+static void kmod_sections(int dfd, kmod_t *m, const kvarea_list_t *areas) {
+    m->text = m->rodata = m->data = m->bss = -1;
 
-    printf("========== Linux Kernel Memory Usage (kernmem) ==========\n\n");
+    char path[192];
+    snprintf(path, sizeof(path), "%s/sections", m->name);
+    int sfd = openat(dfd, path, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (sfd < 0)
+        return;
+    DIR *dp = fdopendir(sfd);
+    if (!dp) {
+        close(sfd);
+        return;
+    }
 
-    if (static_ok == 0) {
-        printf("Static kernel ELF sections (.text/.data/.bss):\n");
-        printf("  .text:      %10llu kB\n", text_kb);
-        printf("  .data:      %10llu kB\n", data_kb);
-        printf("  .bss:       %10llu kB\n", bss_kb);
-        printf("  Static total: %8ld kB (%.2f MB)\n\n",
-               static_total_kb, static_total_kb / 1024.0);
-    } else {
-        printf("Static kernel ELF sections: unavailable "
-               "(no usable System.map/kallsyms)\n\n");
+    ksect_t *s = NULL;
+    size_t n = 0, cap = 0;
+    struct dirent *de;
+    while ((de = readdir(dp)) != NULL) {
+        if (de->d_name[0] == '.' && (de->d_name[1] == '\0' ||
+                                     (de->d_name[1] == '.' && de->d_name[2] == '\0')))
+            continue;
+        if (strncmp(de->d_name, ".init", 5) == 0)
+            continue;          /* freed after load */
+        char buf[64];
+        if (kmod_attr(sfd, ".", de->d_name, buf, sizeof(buf)) != 0)
+            continue;
+        unsigned long long addr = strtoull(buf, NULL, 16);
+        if (addr == 0)
+            continue;          /* hidden by kptr_restrict */
+        if (n == cap) {
+            size_t ncap = cap ? cap * 2 : 64;
+            ksect_t *ns = realloc(s, ncap * sizeof(*ns));
+            if (!ns)
+                break;
+            s = ns;
+            cap = ncap;
+        }
+        snprintf(s[n].name, sizeof(s[n].name), "%.63s", de->d_name);
+        s[n].addr = addr;
+        n++;
     }
+    closedir(dp);
 
-    printf("Dynamic kernel allocations (/proc/meminfo):\n");
-    if (slab_kb >= 0)
-        printf("  Slab:        %10ld kB\n", slab_kb);
-    if (pagetables_kb >= 0)
-        printf("  PageTables:  %10ld kB\n", pagetables_kb);
-    if (vmalloc_kb >= 0)
-        printf("  VmallocUsed: %10ld kB\n", vmalloc_kb);
-    if (kstack_kb >= 0)
-        printf("  KernelStack: %10ld kB\n", kstack_kb);
-    printf("  Dynamic total: %8ld kB (%.2f MB)\n\n",
-           dynamic_total_kb, dynamic_total_kb / 1024.0);
-
-    printf("Module memory (/proc/modules):\n");
-    if (modules_kb >= 0)
-        printf("  Modules:     %10ld kB (%.2f MB)\n\n",
-               modules_kb, modules_kb / 1024.0);
+    if (n > 0) {
+        qsort(s, n, sizeof(*s), ksect_cmp);
+        m->text = m->rodata = m->data = m->bss = 0;
+        for (size_t i = 0; i < n; i++) {
+            long *col = ksect_column(m, s[i].name);
+            if (!col || *col < 0)
+                continue;
+            unsigned long long end = kvarea_end(areas, s[i].addr);
+            unsigned long long next = i + 1 < n ? s[i + 1].addr : 0;
+            if (end) {
+                if (next && next < end)
+                    end = next;
+            } else if (next && (m->core <= 0 || next - s[i].addr <= (unsigned long long)m->core)) {
+                end = next;
+            } else {
+                *col = -1;     /* runs to an allocation end we cannot see */
+                continue;
+            }
+            *col += (long)(end - s[i].addr);
+        }
+    }
+    free(s);
+}
+
+static void kmod_read(int dfd, kmod_t *m, const kvarea_list_t *areas) {
+    char buf[64];
+    m->core = kmod_attr(dfd, m->name, "coresize", buf, sizeof(buf)) == 0 ? atol(buf) : -1;
+    m->init = kmod_attr(dfd, m->name, "initsize", buf, sizeof(buf)) == 0 ? atol(buf) : -1;
+    m->refcnt = kmod_attr(dfd, m->name, "refcnt", buf, sizeof(buf)) == 0 ? atoi(buf) : -1;
+    if (kmod_attr(dfd, m->name, "taint", m->taint, sizeof(m->taint)) != 0)
+        m->taint[0] = '\0';
+    kmod_sections(dfd, m, areas);
+}
+
+typedef struct {
+    int dfd;
+    const kvarea_list_t *areas;
+    kmod_list_t *l;
+    size_t first;
+    size_t step;
+} kmod_job_t;
+
+static void *kmod_worker(void *arg) {
+    kmod_job_t *j = arg;
+    for (size_t i = j->first; i < j->l->n; i += j->step)
+        kmod_read(j->dfd, &j->l->m[i], j->areas);
+    return NULL;
+}
+
+static int kmod_cmp_core(const void *a, const void *b) {
+    const kmod_t *x = a, *y = b;
+    return (x->core < y->core) - (x->core > y->core);
+}
+
+/* Every loadable module (one with a coresize), largest first */
+static int kmod_collect(kmod_list_t *l) {
+    int dfd = open(MODULE_SYSFS, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (dfd < 0)
+        return -1;
+    int fd = dup(dfd);
+    DIR *dp = fd >= 0 ? fdopendir(fd) : NULL;
+    if (!dp) {
+        if (fd >= 0) close(fd);
+        close(dfd);
+        return -1;
+    }
+
+    size_t cap = 0;
+    struct dirent *de;
+    while ((de = readdir(dp)) != NULL) {
+        if (de->d_name[0] == '.')
+            continue;
+        char path[192];
+        snprintf(path, sizeof(path), "%.63s/coresize", de->d_name);
+        if (faccessat(dfd, path, F_OK, 0) != 0)
+            continue;          /* built in */
+        if (l->n == cap) {
+            size_t ncap = cap ? cap * 2 : 128;
+            kmod_t *nm = realloc(l->m, ncap * sizeof(*nm));
+            if (!nm)
+                break;
+            l->m = nm;
+            cap = ncap;
+        }
+        memset(&l->m[l->n], 0, sizeof(l->m[0]));
+        snprintf(l->m[l->n].name, sizeof(l->m[0].name), "%.63s", de->d_name);
+        l->n++;
+    }
+    closedir(dp);
+
+    kvarea_list_t areas = {0};
+    kvarea_collect(&areas);
+
+    int nthreads = l->n >= MODULE_THREAD_MIN ? MODULE_THREADS : 1;
+    pthread_t tids[MODULE_THREADS];
+    kmod_job_t jobs[MODULE_THREADS];
+    int started = 0;
+    for (int i = 0; i < nthreads; i++) {
+        jobs[i] = (kmod_job_t){ dfd, &areas, l, (size_t)i, (size_t)nthreads };
+        if (i > 0 && pthread_create(&tids[i], NULL, kmod_worker, &jobs[i]) == 0)
+            started |= 1 << i;
+    }
+    /* This thread takes slice 0, plus any slice whose thread failed to start */
+    for (int i = 0; i < nthreads; i++) {
+        if (!(started & (1 << i)))
+            kmod_worker(&jobs[i]);
+    }
+    for (int i = 1; i < nthreads; i++) {
+        if (started & (1 << i))
+            pthread_join(tids[i], NULL);
+    }
+    close(dfd);
+    free(areas.a);
+
+    qsort(l->m, l->n, sizeof(l->m[0]), kmod_cmp_core);
+    return 0;
+}
+
+/* Section size column: kB, or "-" when unknown */
+static void print_kb_col(long bytes, int width) {
+    if (bytes < 0)
+        printf(" %*s", width, "-");
     else
-        printf("  Modules:     unavailable (no /proc/modules)\n\n");
+        printf(" %*ld", width, bytes / 1024);
+}
 
-    printf("============================================================\n");
-    printf("Estimated TOTAL kernel memory: %ld kB (%.2f MB)\n",
-           grand_total_kb, grand_total_kb / 1024.0);
+static void print_modules(const kmod_list_t *l, int top) {
+    long core = 0, init = 0;
+    for (size_t i = 0; i < l->n; i++) {
+        core += l->m[i].core > 0 ? l->m[i].core : 0;
+        init += l->m[i].init > 0 ? l->m[i].init : 0;
+    }
+    size_t shown = (top > 0 && (size_t)top < l->n) ? (size_t)top : l->n;
+    printf("\nModules (%s), top %zu of %zu by core size:\n", MODULE_SYSFS, shown, l->n);
+    printf("  %-24s %9s %8s %8s %8s %8s %8s %6s  %s\n", "Module", "Core kB", "Init kB",
+           "Text", "Rodata", "Data", "Bss", "Refs", "Taint");
+    for (size_t i = 0; i < shown; i++) {
+        const kmod_t *m = &l->m[i];
+        printf("  %-24s", m->name);
+        print_kb_col(m->core, 9);
+        print_kb_col(m->init, 8);
+        print_kb_col(m->text, 8);
+        print_kb_col(m->rodata, 8);
+        print_kb_col(m->data, 8);
+        print_kb_col(m->bss, 8);
+        printf(" %6d  %s\n", m->refcnt, m->taint);
+    }
+    printf("  Total: core %ld kB, init %ld kB\n", core / 1024, init / 1024);
+}
+
+static void print_modules_json(const kmod_list_t *l, int top) {
+    size_t shown = (top > 0 && (size_t)top < l->n) ? (size_t)top : l->n;
+    printf(",\n  \"modules\": {\"count\": %zu, \"top\": [", l->n);
+    for (size_t i = 0; i < shown; i++) {
+        const kmod_t *m = &l->m[i];
+        printf("%s\n    {\"name\": ", i ? "," : "");
+        json_put_str(stdout, m->name);
+        printf(", ");
+        json_kb("core_kb", m->core >= 0 ? m->core / 1024 : -1, ", ");
+        json_kb("init_kb", m->init >= 0 ? m->init / 1024 : -1, ", ");
+        json_kb("text_kb", m->text >= 0 ? m->text / 1024 : -1, ", ");
+        json_kb("rodata_kb", m->rodata >= 0 ? m->rodata / 1024 : -1, ", ");
+        json_kb("data_kb", m->data >= 0 ? m->data / 1024 : -1, ", ");
+        json_kb("bss_kb", m->bss >= 0 ? m->bss / 1024 : -1, ", ");
+        printf("\"refcnt\": %d, \"taint\": \"%s\"}", m->refcnt, m->taint);
+    }
+    printf("\n  ]}");
+}
+
+/* ---------- Slab caches ---------- */
+
+/*
+ * Per-cache memory from /proc/slabinfo: num_slabs * pagesperslab pages,
+ * of which active_objs * objsize are live objects and the rest is slab
+ * overhead (free slots, padding, metadata).  When slabinfo is not readable
+ * (it is 0400 on most distributions) the SLUB directories under
+ * /sys/kernel/slab provide the same figures.
+ *
+ * SLUB merges compatible caches; sysfs shows every cache name as a
+ * symlink to the merged directory, which also says whether the cache is
+ * SLAB_RECLAIM_ACCOUNT (reclaim_account).
+ */
+#define SLABINFO_PATH "/proc/slabinfo"
+#define SLAB_SYSFS    "/sys/kernel/slab"
+
+typedef struct {
+    char name[64];
+    long active_objs;
+    long num_objs;
+    long objsize;
+    long num_slabs;
+    unsigned long long total_bytes;   /* pages backing the slabs */
+    unsigned long long used_bytes;    /* active_objs * objsize */
+    int  reclaimable;                 /* 1, 0, or -1 if unknown */
+    char aliases[512];                /* other names merged into this cache */
+} slab_cache_t;
+
+typedef struct {
+    slab_cache_t *c;
+    size_t n;
+    size_t cap;
+    const char *source;
+} slab_list_t;
+
+typedef struct {
+    char name[64];
+    char target[64];                  /* merged sysfs directory */
+} slab_alias_t;
+
+typedef struct {
+    slab_alias_t *a;
+    size_t n;
+    size_t cap;
+} slab_alias_list_t;
+
+static slab_cache_t *slab_add(slab_list_t *l) {
+    if (l->n == l->cap) {
+        size_t ncap = l->cap ? l->cap * 2 : 256;
+        slab_cache_t *nc = realloc(l->c, ncap * sizeof(*nc));
+        if (!nc)
+            return NULL;
+        l->c = nc;
+        l->cap = ncap;
+    }
+    slab_cache_t *c = &l->c[l->n++];
+    memset(c, 0, sizeof(*c));
+    c->reclaimable = -1;
+    return c;
+}
+
+static void slab_free(slab_list_t *l) {
+    free(l->c);
+    memset(l, 0, sizeof(*l));
+}
+
+/* Every symlink in /sys/kernel/slab: cache name -> merged directory */
+static void slab_read_aliases(int dfd, slab_alias_list_t *al) {
+    int fd = dup(dfd);
+    DIR *dp = fd >= 0 ? fdopendir(fd) : NULL;
+    if (!dp) {
+        if (fd >= 0) close(fd);
+        return;
+    }
+    rewinddir(dp);    /* the dup shares dfd's offset */
+    struct dirent *de;
+    while ((de = readdir(dp)) != NULL) {
+        if (de->d_type != DT_LNK)
+            continue;
+        char target[PATH_MAX];
+        ssize_t len = readlinkat(dfd, de->d_name, target, sizeof(target) - 1);
+        if (len <= 0)
+            continue;
+        target[len] = '\0';
+        const char *base = strrchr(target, '/');
+        base = base ? base + 1 : target;
+
+        if (al->n == al->cap) {
+            size_t ncap = al->cap ? al->cap * 2 : 256;
+            slab_alias_t *na = realloc(al->a, ncap * sizeof(*na));
+            if (!na)
+                break;
+            al->a = na;
+            al->cap = ncap;
+        }
+        snprintf(al->a[al->n].name, sizeof(al->a[0].name), "%.63s", de->d_name);
+        snprintf(al->a[al->n].target, sizeof(al->a[0].target), "%.63s", base);
+        al->n++;
+    }
+    closedir(dp);
+}
+
+/* Merged sysfs directory of a cache name (itself if it is not an alias) */
+static const char *slab_target(const slab_alias_list_t *al, const char *name) {
+    for (size_t i = 0; i < al->n; i++) {
+        if (strcmp(al->a[i].name, name) == 0)
+            return al->a[i].target;
+    }
+    return name;
+}
+
+/* First number of a sysfs slab attribute ("32 N0=32"), -1 if missing */
+static long slab_attr(int dfd, const char *dir, const char *attr) {
+    char path[192], buf[64];
+    snprintf(path, sizeof(path), "%s/%s", dir, attr);
+    int fd = openat(dfd, path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+        return -1;
+    ssize_t n = read(fd, buf, sizeof(buf) - 1);
+    close(fd);
+    if (n <= 0)
+        return -1;
+    buf[n] = '\0';
+    return strtol(buf, NULL, 10);
+}
+
+/* Parse a /proc/slabinfo buffer (modified in place) into l */
+static void slab_parse_slabinfo(char *buf, slab_list_t *l, long page_size) {
+    char *save;
+    for (char *line = strtok_r(buf, "\n", &save); line; line = strtok_r(NULL, "\n", &save)) {
+        char name[64];
+        long active, num, objsize, perslab, pages, active_slabs, num_slabs;
+        if (line[0] == '#' || strncmp(line, "slabinfo", 8) == 0)
+            continue;
+        if (sscanf(line, "%63s %ld %ld %ld %ld %ld : tunables %*d %*d %*d : slabdata %ld %ld",
+                   name, &active, &num, &objsize, &perslab, &pages,
+                   &active_slabs, &num_slabs) != 8)
+            continue;
+        slab_cache_t *c = slab_add(l);
+        if (!c)
+            break;
+        snprintf(c->name, sizeof(c->name), "%.63s", name);
+        c->active_objs = active;
+        c->num_objs = num;
+        c->objsize = objsize;
+        c->num_slabs = num_slabs;
+        c->total_bytes = (unsigned long long)num_slabs * (unsigned long long)pages * page_size;
+        c->used_bytes = (unsigned long long)active * (unsigned long long)objsize;
+    }
+    l->source = SLABINFO_PATH;
+}
+
+static int slab_read_slabinfo(slab_list_t *l, long page_size) {
+    char *buf = read_whole(SLABINFO_PATH);
+    if (!buf)
+        return -1;
+    slab_parse_slabinfo(buf, l, page_size);
+    free(buf);
+    return 0;
+}
+
+/* One row per merged directory, named after its first alias */
+static int slab_read_sysfs(int dfd, const slab_alias_list_t *al, slab_list_t *l, long page_size) {
+    int fd = dup(dfd);
+    DIR *dp = fd >= 0 ? fdopendir(fd) : NULL;
+    if (!dp) {
+        if (fd >= 0) close(fd);
+        return -1;
+    }
+    rewinddir(dp);
+    struct dirent *de;
+    while ((de = readdir(dp)) != NULL) {
+        if (de->d_type != DT_DIR || de->d_name[0] == '.')
+            continue;
+        long objects = slab_attr(dfd, de->d_name, "objects");
+        long total   = slab_attr(dfd, de->d_name, "total_objects");
+        long objsize = slab_attr(dfd, de->d_name, "object_size");
+        long slabs   = slab_attr(dfd, de->d_name, "slabs");
+        long order   = slab_attr(dfd, de->d_name, "order");
+        if (objects < 0 || slabs < 0 || order < 0)
+            continue;
+
+        slab_cache_t *c = slab_add(l);
+        if (!c)
+            break;
+        const char *name = de->d_name;
+        for (size_t i = 0; i < al->n; i++) {
+            if (strcmp(al->a[i].target, de->d_name) == 0) {
+                name = al->a[i].name;
+                break;
+            }
+        }
+        snprintf(c->name, sizeof(c->name), "%.63s", name);
+        c->active_objs = objects;
+        c->num_objs = total;
+        c->objsize = objsize;
+        c->num_slabs = slabs;
+        c->total_bytes = (unsigned long long)slabs * ((unsigned long long)page_size << order);
+        c->used_bytes = (unsigned long long)objects * (unsigned long long)(objsize > 0 ? objsize : 0);
+    }
+    closedir(dp);
+    l->source = SLAB_SYSFS;
+    /* The attributes are root-only on many kernels */
+    return l->n ? 0 : -1;
+}
+
+static int slab_cmp_total(const void *a, const void *b) {
+    const slab_cache_t *x = a, *y = b;
+    return (x->total_bytes < y->total_bytes) - (x->total_bytes > y->total_bytes);
+}
+
+/* Read every cache, resolve aliases and reclaimability, sort by memory */
+static int slab_collect(slab_list_t *l) {
+    long page_size = sysconf(_SC_PAGESIZE);
+    slab_alias_list_t al = {0};
+    int dfd = open(SLAB_SYSFS, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (dfd >= 0)
+        slab_read_aliases(dfd, &al);
+
+    int rc = slab_read_slabinfo(l, page_size);
+    if (rc != 0 && dfd >= 0)
+        rc = slab_read_sysfs(dfd, &al, l, page_size);
+
+    for (size_t i = 0; rc == 0 && dfd >= 0 && i < l->n; i++) {
+        slab_cache_t *c = &l->c[i];
+        const char *target = slab_target(&al, c->name);
+        c->reclaimable = (int)slab_attr(dfd, target, "reclaim_account");
+
+        size_t used = 0;
+        for (size_t j = 0; j < al.n; j++) {
+            if (strcmp(al.a[j].target, target) != 0 || strcmp(al.a[j].name, c->name) == 0)
+                continue;
+            int w = snprintf(c->aliases + used, sizeof(c->aliases) - used, "%s%s",
+                             used ? "," : "", al.a[j].name);
+            if (w < 0 || (size_t)w >= sizeof(c->aliases) - used)
+                break;
+            used += (size_t)w;
+        }
+    }
+
+    if (dfd >= 0)
+        close(dfd);
+    free(al.a);
+    if (rc == 0)
+        qsort(l->c, l->n, sizeof(l->c[0]), slab_cmp_total);
+    return rc;
+}
+
+static void print_slab(const slab_list_t *l, int top, const meminfo_t *mi) {
+    unsigned long long recl = 0, unrecl = 0, unknown = 0;
+    for (size_t i = 0; i < l->n; i++) {
+        if (l->c[i].reclaimable > 0)
+            recl += l->c[i].total_bytes;
+        else if (l->c[i].reclaimable == 0)
+            unrecl += l->c[i].total_bytes;
+        else
+            unknown += l->c[i].total_bytes;
+    }
+
+    size_t shown = (top > 0 && (size_t)top < l->n) ? (size_t)top : l->n;
+    printf("\nSlab caches (%s), top %zu of %zu by memory:\n", l->source, shown, l->n);
+    printf("  %-24s %11s %11s %10s %9s %8s %4s  %s\n", "Cache", "Total kB", "Used kB",
+           "Ovhd kB", "Objects", "ObjSize", "Recl", "Aliases");
+    for (size_t i = 0; i < shown; i++) {
+        const slab_cache_t *c = &l->c[i];
+        unsigned long long ovhd = c->total_bytes > c->used_bytes ? c->total_bytes - c->used_bytes : 0;
+        printf("  %-24s %11llu %11llu %10llu %9ld %8ld %4s  %s\n", c->name,
+               c->total_bytes / 1024, c->used_bytes / 1024, ovhd / 1024, c->active_objs,
+               c->objsize, c->reclaimable > 0 ? "yes" : c->reclaimable == 0 ? "no" : "?",
+               c->aliases);
+    }
+    printf("  Reclaimable:   %10llu kB (SReclaimable %ld kB)\n", recl / 1024, mi->v[MI_SRECLAIMABLE]);
+    printf("  Unreclaimable: %10llu kB (SUnreclaim %ld kB)\n", unrecl / 1024, mi->v[MI_SUNRECLAIM]);
+    if (unknown)
+        printf("  Unknown:       %10llu kB (no /sys/kernel/slab)\n", unknown / 1024);
+}
+
+static void print_slab_json(const slab_list_t *l, int top) {
+    size_t shown = (top > 0 && (size_t)top < l->n) ? (size_t)top : l->n;
+    printf(",\n  \"slab\": {\"source\": \"%s\", \"caches\": %zu, \"top\": [", l->source, l->n);
+    for (size_t i = 0; i < shown; i++) {
+        const slab_cache_t *c = &l->c[i];
+        printf("%s\n    {\"name\": ", i ? "," : "");
+        json_put_str(stdout, c->name);
+        printf(", \"total_kb\": %llu, \"used_kb\": %llu, "
+               "\"objects\": %ld, \"num_objs\": %ld, \"objsize\": %ld, \"slabs\": %ld, "
+               "\"reclaimable\": %s, \"aliases\": ",
+               c->total_bytes / 1024, c->used_bytes / 1024,
+               c->active_objs, c->num_objs, c->objsize, c->num_slabs,
+               c->reclaimable > 0 ? "true" : c->reclaimable == 0 ? "false" : "null");
+        json_put_str(stdout, c->aliases);
+        printf("}");
+    }
+    printf("\n  ]}");
+}
+
+/* ---------- Allocation profiling ---------- */
+
+/*
+ * Kernels built with CONFIG_MEM_ALLOC_PROFILING expose /proc/allocinfo:
+ * live bytes and allocation calls per call site, one line each as
+ * "bytes calls file:line [module] func:name ...".  --alloc-sites folds
+ * the sites by module (vmlinux for built-in code), by source file and by
+ * function; --watch shows the functions whose bytes changed.
+ */
+#define ALLOCINFO_PATH "/proc/allocinfo"
+
+typedef struct {
+    agg_t by_module;
+    agg_t by_file;
+    agg_t by_func;                 /* bytes, units = calls, n = sites */
+    unsigned long long bytes;
+    unsigned long long calls;
+    long sites;
+} alloc_agg_t;
+
+static void alloc_parse(char *buf, alloc_agg_t *a) {
+    char *save;
+    for (char *line = strtok_r(buf, "\n", &save); line; line = strtok_r(NULL, "\n", &save)) {
+        char *p;
+        unsigned long long bytes = strtoull(line, &p, 10);
+        if (p == line)
+            continue;                     /* "allocinfo - version" and "#" headers */
+        unsigned long long calls = strtoull(p, &p, 10);
+        while (*p == ' ')
+            p++;
+
+        /* file:line */
+        const char *file = p;
+        size_t flen = strcspn(p, " ");
+        const char *colon = memchr(file, ':', flen);
+        p += flen;
+
+        const char *mod = "vmlinux", *func = NULL;
+        size_t mlen = 7, fnlen = 0;
+        for (;;) {
+            while (*p == ' ')
+                p++;
+            size_t tl = strcspn(p, " ");
+            if (tl == 0)
+                break;
+            if (p[0] == '[' && p[tl - 1] == ']') {
+                mod = p + 1;
+                mlen = tl - 2;
+            } else if (strncmp(p, "func:", 5) == 0) {
+                func = p + 5;
+                fnlen = tl - 5;
+            }
+            p += tl;
+        }
+
+        agg_add(&a->by_module, mod, mlen, bytes, calls);
+        agg_add(&a->by_file, file, colon ? (size_t)(colon - file) : flen, bytes, calls);
+        if (func)
+            agg_add(&a->by_func, func, fnlen, bytes, calls);
+        a->bytes += bytes;
+        a->calls += calls;
+        a->sites++;
+    }
+}
+
+static void alloc_free(alloc_agg_t *a) {
+    agg_free(&a->by_module);
+    agg_free(&a->by_file);
+    agg_free(&a->by_func);
+    memset(a, 0, sizeof(*a));
+}
+
+/* 0, or -1 with errno (ENOENT: kernel without allocation profiling) */
+static int alloc_collect(alloc_agg_t *a) {
+    char *buf = read_whole(ALLOCINFO_PATH);
+    if (!buf)
+        return -1;
+    alloc_parse(buf, a);
+    free(buf);
+    agg_sort(&a->by_module);
+    agg_sort(&a->by_file);
+    agg_sort(&a->by_func);
+    return 0;
+}
+
+static void alloc_unavailable(int err) {
+    if (err == ENOENT)
+        fprintf(stderr, "%s not present: kernel built without CONFIG_MEM_ALLOC_PROFILING\n",
+                ALLOCINFO_PATH);
+    else
+        fprintf(stderr, "Cannot read %s: %s\n", ALLOCINFO_PATH, strerror(err));
+}
+
+static void print_alloc_table(const char *what, const char *col, const agg_t *g, int top) {
+    size_t shown = (top > 0 && (size_t)top < g->n) ? (size_t)top : g->n;
+    printf("  Top %zu of %zu by %s:\n", shown, g->n, what);
+    printf("    %-48s %8s %12s %12s\n", col, "Sites", "kB", "Calls");
+    for (size_t i = 0; i < shown; i++) {
+        const char *k = g->slot[i].key;
+        size_t kl = strlen(k);
+        /* keep the tail of long source paths */
+        printf("    %s%-*s %8ld %12llu %12llu\n", kl > 48 ? "..." : "",
+               kl > 48 ? 45 : 48, kl > 48 ? k + kl - 45 : k, g->slot[i].n,
+               g->slot[i].bytes / 1024, g->slot[i].units);
+    }
+}
+
+static void print_alloc(const alloc_agg_t *a, int top) {
+    printf("\nAllocation sites (%s): %ld sites, %llu kB live, %llu calls\n",
+           ALLOCINFO_PATH, a->sites, a->bytes / 1024, a->calls);
+    if (a->sites > 0 && a->calls == 0)
+        printf("  (all counters are zero: profiling off, see sysctl vm.mem_profiling)\n");
+    print_alloc_table("module", "Module", &a->by_module, top);
+    print_alloc_table("file", "File", &a->by_file, top);
+    print_alloc_table("function", "Function", &a->by_func, top);
+}
+
+static void print_alloc_json_table(const char *key, const agg_t *g, int top, const char *sep) {
+    size_t shown = (top > 0 && (size_t)top < g->n) ? (size_t)top : g->n;
+    printf("\"%s\": [", key);
+    for (size_t i = 0; i < shown; i++) {
+        printf("%s\n    {\"name\": ", i ? "," : "");
+        json_put_str(stdout, g->slot[i].key);
+        printf(", \"sites\": %ld, \"bytes\": %llu, \"calls\": %llu}",
+               g->slot[i].n, g->slot[i].bytes, g->slot[i].units);
+    }
+    printf("\n  ]%s", sep);
+}
+
+static void print_alloc_json(const alloc_agg_t *a, int top) {
+    if (!a) {
+        printf(",\n  \"alloc_sites\": null");
+        return;
+    }
+    printf(",\n  \"alloc_sites\": {\"sites\": %ld, \"bytes\": %llu, \"calls\": %llu, ",
+           a->sites, a->bytes, a->calls);
+    print_alloc_json_table("by_module", &a->by_module, top, ", ");
+    print_alloc_json_table("by_file", &a->by_file, top, ", ");
+    print_alloc_json_table("by_function", &a->by_func, top, "}");
+}
+
+/* ---------- Buddy allocator fragmentation ---------- */
+
+/*
+ * --frag reads the free block counts per order from /proc/buddyinfo, and
+ * per migrate type plus pageblock counts from /proc/pagetypeinfo when it
+ * is readable (root).  Per zone and order it derives what the kernel's
+ * extfrag debugfs files show:
+ *
+ *   unusable  free memory in blocks smaller than the order, i.e. of no use
+ *             to an allocation of that order
+ *   index     0..1 when the allocation would fail: near 0 for lack of
+ *             memory, near 1 because of fragmentation; -1 when a block of
+ *             that order is free
+ *
+ * With --watch it reports the same for all zones together, plus the
+ * compaction and THP allocation counters from /proc/vmstat.
+ */
+#define BUDDYINFO_PATH    "/proc/buddyinfo"
+#define PAGETYPEINFO_PATH "/proc/pagetypeinfo"
+#define VMSTAT_PATH       "/proc/vmstat"
+#define FRAG_MAX_ORDER    16
+#define FRAG_MAX_ZONES    32
+#define FRAG_MAX_TYPES    8
+
+typedef struct {
+    int node;
+    char zone[16];
+    unsigned long free[FRAG_MAX_ORDER];                   /* free blocks per order */
+    unsigned long type_free[FRAG_MAX_TYPES][FRAG_MAX_ORDER];
+    unsigned long blocks[FRAG_MAX_TYPES];                 /* pageblocks per type */
+} frag_zone_t;
+
+typedef struct {
+    frag_zone_t z[FRAG_MAX_ZONES];
+    int nzones;
+    int norders;
+    int ntypes;                     /* 0 without pagetypeinfo */
+    char type[FRAG_MAX_TYPES][16];
+    int pageblock_order;            /* -1 if unknown */
+} frag_t;
+
+/* "key value" from a vmstat-style buffer, -1 if absent */
+static long long vmstat_get(const char *buf, const char *key) {
+    size_t klen = strlen(key);
+    for (const char *p = buf; p && *p; ) {
+        if (strncmp(p, key, klen) == 0 && p[klen] == ' ')
+            return strtoll(p + klen + 1, NULL, 10);
+        p = strchr(p, '\n');
+        if (p)
+            p++;
+    }
+    return -1;
+}
+
+static frag_zone_t *frag_zone(frag_t *f, int node, const char *zone, int add) {
+    for (int i = 0; i < f->nzones; i++) {
+        if (f->z[i].node == node && strcmp(f->z[i].zone, zone) == 0)
+            return &f->z[i];
+    }
+    if (!add || f->nzones == FRAG_MAX_ZONES)
+        return NULL;
+    frag_zone_t *z = &f->z[f->nzones++];
+    memset(z, 0, sizeof(*z));
+    z->node = node;
+    snprintf(z->zone, sizeof(z->zone), "%s", zone);
+    return z;
+}
+
+static int frag_type(frag_t *f, const char *name) {
+    for (int i = 0; i < f->ntypes; i++) {
+        if (strcmp(f->type[i], name) == 0)
+            return i;
+    }
+    if (f->ntypes == FRAG_MAX_TYPES)
+        return -1;
+    snprintf(f->type[f->ntypes], sizeof(f->type[0]), "%s", name);
+    return f->ntypes++;
+}
+
+/* Counts after *p, up to FRAG_MAX_ORDER; returns how many */
+static int frag_counts(char *p, unsigned long *out) {
+    int n = 0;
+    for (char *end; n < FRAG_MAX_ORDER; n++) {
+        unsigned long v = strtoul(p, &end, 10);
+        if (end == p)
+            break;
+        out[n] = v;
+        p = end;
+    }
+    return n;
+}
+
+/* "Node 0, zone   Normal   3804    934 ..." */
+static void frag_parse_buddyinfo(char *buf, frag_t *f) {
+    char *save;
+    for (char *line = strtok_r(buf, "\n", &save); line; line = strtok_r(NULL, "\n", &save)) {
+        int node, off = 0;
+        char zone[16];
+        if (sscanf(line, "Node %d, zone %15s %n", &node, zone, &off) != 2 || off == 0)
+            continue;
+        frag_zone_t *z = frag_zone(f, node, zone, 1);
+        if (!z)
+            continue;
+        int n = frag_counts(line + off, z->free);
+        if (n > f->norders)
+            f->norders = n;
+    }
+}
+
+/*
+ * "Page block order: 9", then per zone and type
+ * "Node    0, zone   Normal, type    Movable   3679    912 ...", then
+ * "Number of blocks type     Unmovable      Movable ..." and per zone
+ * "Node 0, zone   Normal           54          447 ...".
+ */
+static void frag_parse_pagetypeinfo(char *buf, frag_t *f) {
+    int btype[FRAG_MAX_TYPES], nbtypes = 0;
+    char *save;
+    for (char *line = strtok_r(buf, "\n", &save); line; line = strtok_r(NULL, "\n", &save)) {
+        int node, off = 0;
+        char zone[16], type[16];
+        if (strncmp(line, "Page block order:", 17) == 0) {
+            f->pageblock_order = atoi(line + 17);
+        } else if (strncmp(line, "Number of blocks type", 21) == 0) {
+            char *p = line + 21;
+            for (int len; nbtypes < FRAG_MAX_TYPES && sscanf(p, "%15s%n", type, &len) == 1; p += len)
+                btype[nbtypes++] = frag_type(f, type);
+        } else if (sscanf(line, "Node %d, zone %15[^,], type %15s %n", &node, zone, type, &off) == 3 &&
+                   off > 0) {
+            frag_zone_t *z = frag_zone(f, node, zone, 0);
+            int t = frag_type(f, type);
+            if (z && t >= 0)
+                frag_counts(line + off, z->type_free[t]);
+        } else if (nbtypes > 0 && sscanf(line, "Node %d, zone %15s %n", &node, zone, &off) == 2 &&
+                   off > 0) {
+            frag_zone_t *z = frag_zone(f, node, zone, 0);
+            unsigned long cnt[FRAG_MAX_ORDER];
+            int n = frag_counts(line + off, cnt);
+            for (int i = 0; z && i < n && i < nbtypes; i++) {
+                if (btype[i] >= 0)
+                    z->blocks[btype[i]] = cnt[i];
+            }
+        }
+    }
+}
+
+static int frag_collect(frag_t *f) {
+    memset(f, 0, sizeof(*f));
+    f->pageblock_order = -1;
+    char *buf = read_whole(BUDDYINFO_PATH);
+    if (!buf)
+        return -1;
+    frag_parse_buddyinfo(buf, f);
+    free(buf);
+    if ((buf = read_whole(PAGETYPEINFO_PATH)) != NULL) {
+        frag_parse_pagetypeinfo(buf, f);
+        free(buf);
+    }
+    return f->nzones > 0 ? 0 : -1;
+}
+
+/* Free pages in a zone */
+static unsigned long long frag_free_pages(const unsigned long *free, int norders) {
+    unsigned long long pages = 0;
+    for (int o = 0; o < norders; o++)
+        pages += (unsigned long long)free[o] << o;
+    return pages;
+}
+
+/* Free pages in blocks too small for an order-`order` allocation */
+static unsigned long long frag_unusable_pages(const unsigned long *free, int norders, int order) {
+    unsigned long long small = 0;
+    for (int o = 0; o < order && o < norders; o++)
+        small += (unsigned long long)free[o] << o;
+    return small;
+}
+
+/* The kernel's __fragmentation_index() scaled to 0..1, -1 if the order is free */
+static double frag_index(const unsigned long *free, int norders, int order) {
+    unsigned long long blocks = 0, suitable = 0;
+    for (int o = 0; o < norders; o++) {
+        blocks += free[o];
+        if (o >= order)
+            suitable += (unsigned long long)free[o] << (o - order);
+    }
+    if (blocks == 0)
+        return 0.0;
+    if (suitable > 0)
+        return -1.0;
+    /* Signed: with few blocks the subtrahend can pass 1000 */
+    long long pages = (long long)frag_free_pages(free, norders);
+    long long fi = 1000 - (1000 + pages * 1000 / (1LL << order)) / (long long)blocks;
+    if (fi < 0)
+        fi = 0;
+    if (fi > 1000)
+        fi = 1000;
+    return fi / 1000.0;
+}
+
+/* Order of a PMD-sized (THP) page, from Hugepagesize, else the pageblock order */
+static int frag_thp_order(const frag_t *f, const meminfo_t *mi) {
+    long kpp = sysconf(_SC_PAGESIZE) / 1024;
+    if (mi->v[MI_HUGEPAGESIZE] > 0 && kpp > 0) {
+        int o = 0;
+        while ((kpp << (o + 1)) <= mi->v[MI_HUGEPAGESIZE])
+            o++;
+        if (o < f->norders)
+            return o;
+    }
+    return f->pageblock_order >= 0 ? f->pageblock_order : f->norders - 1;
+}
+
+static void print_frag_row(const char *label, const unsigned long *v, int norders) {
+    printf("    %-12s", label);
+    for (int o = 0; o < norders; o++)
+        printf(" %7lu", v[o]);
+    printf("\n");
+}
+
+static void print_frag(const frag_t *f, const meminfo_t *mi) {
+    long kpp = sysconf(_SC_PAGESIZE) / 1024;
+    int thp = frag_thp_order(f, mi);
+    printf("\nBuddy allocator fragmentation (%s%s):\n", BUDDYINFO_PATH,
+           f->ntypes ? ", " PAGETYPEINFO_PATH : "");
+    for (int i = 0; i < f->nzones; i++) {
+        const frag_zone_t *z = &f->z[i];
+        unsigned long long free_pages = frag_free_pages(z->free, f->norders);
+        printf("  Node %d, zone %s: %llu kB free", z->node, z->zone, free_pages * kpp);
+        if (free_pages > 0) {
+            unsigned long long bad = frag_unusable_pages(z->free, f->norders, thp);
+            printf(", %llu kB (%.1f%%) unusable for order-%d (THP)", bad * kpp,
+                   100.0 * bad / free_pages, thp);
+        }
+        printf("\n");
+        if (free_pages == 0)
+            continue;
+
+        printf("    %-12s", "Order");
+        for (int o = 0; o < f->norders; o++)
+            printf(" %7d", o);
+        printf("\n");
+        print_frag_row("Free blocks", z->free, f->norders);
+        for (int t = 0; t < f->ntypes; t++)
+            print_frag_row(f->type[t], z->type_free[t], f->norders);
+        printf("    %-12s", "Unusable kB");
+        for (int o = 0; o < f->norders; o++)
+            printf(" %7llu", frag_unusable_pages(z->free, f->norders, o) * kpp);
+        printf("\n    %-12s", "Unusable %");
+        for (int o = 0; o < f->norders; o++)
+            printf(" %7.1f", 100.0 * frag_unusable_pages(z->free, f->norders, o) / free_pages);
+        printf("\n    %-12s", "Frag index");
+        for (int o = 0; o < f->norders; o++) {
+            double fi = frag_index(z->free, f->norders, o);
+            if (fi < 0)
+                printf(" %7s", "-");
+            else
+                printf(" %7.3f", fi);
+        }
+        printf("\n");
+        if (f->ntypes > 0) {
+            printf("    Pageblocks:");
+            for (int t = 0; t < f->ntypes; t++)
+                printf(" %s %lu%s", f->type[t], z->blocks[t], t + 1 < f->ntypes ? "," : "");
+            printf("\n");
+        }
+    }
+    if (f->ntypes == 0)
+        printf("  (%s not readable: no per-migrate-type split)\n", PAGETYPEINFO_PATH);
+}
+
+static void print_frag_json_ul(const char *key, const unsigned long *v, int n, const char *sep) {
+    printf("\"%s\": [", key);
+    for (int o = 0; o < n; o++)
+        printf("%s%lu", o ? ", " : "", v[o]);
+    printf("]%s", sep);
+}
+
+static void print_frag_json(const frag_t *f) {
+    long kpp = sysconf(_SC_PAGESIZE) / 1024;
+    printf(",\n  \"frag\": {\"pageblock_order\": %d, \"zones\": [", f->pageblock_order);
+    for (int i = 0; i < f->nzones; i++) {
+        const frag_zone_t *z = &f->z[i];
+        printf("%s\n    {\"node\": %d, \"zone\": \"%s\", \"free_kb\": %llu, ", i ? "," : "",
+               z->node, z->zone, frag_free_pages(z->free, f->norders) * kpp);
+        print_frag_json_ul("free_blocks", z->free, f->norders, ", ");
+        printf("\"unusable_kb\": [");
+        for (int o = 0; o < f->norders; o++)
+            printf("%s%llu", o ? ", " : "", frag_unusable_pages(z->free, f->norders, o) * kpp);
+        printf("], \"frag_index\": [");
+        for (int o = 0; o < f->norders; o++)
+            printf("%s%.3f", o ? ", " : "", frag_index(z->free, f->norders, o));
+        printf("]");
+        if (f->ntypes > 0) {
+            printf(", \"types\": {");
+            for (int t = 0; t < f->ntypes; t++) {
+                printf("%s\"%s\": {", t ? ", " : "", f->type[t]);
+                print_frag_json_ul("free_blocks", z->type_free[t], f->norders, ", ");
+                printf("\"pageblocks\": %lu}", z->blocks[t]);
+            }
+            printf("}");
+        }
+        printf("}");
+    }
+    printf("\n  ]}");
+}
+
+/* ---------- Watch mode ---------- */
+
+/*
+ * --watch INTERVAL keeps /proc/meminfo, /proc/slabinfo and
+ * /proc/vmallocinfo open and re-reads them with pread() every interval.
+ * Each category and each slab cache keeps a rolling window of samples; a
+ * least-squares slope over the window gives its trend.  A series that
+ * never shrank across a full window and grew in at least half of its
+ * steps is flagged as a suspected leak.
+ */
+#define WATCH_WINDOW     60         /* samples per trend window */
+
+typedef struct {
+    double *t;                      /* seconds since start */
+    double *v;                      /* kB */
+    int cap;
+    int n;
+    int head;                       /* next slot */
+} trend_t;
+
+typedef struct {
+    char name[64];
+    trend_t tr;
+    double last;
+    double delta;                   /* change over the last interval */
+    int seen;                       /* present in the latest sample */
+} wseries_t;
+
+/* Summed pages= of /proc/vmallocinfo: memory actually backing vmalloc areas */
+static long vmallocinfo_pages_kb(const char *buf) {
+    long long pages = 0;
+    for (const char *p = strstr(buf, "pages="); p; p = strstr(p + 6, "pages="))
+        pages += strtoll(p + 6, NULL, 10);
+    return (long)(pages * (sysconf(_SC_PAGESIZE) / 1024));
+}
+
+static int trend_init(trend_t *tr, int cap) {
+    tr->t = calloc((size_t)cap, sizeof(double));
+    tr->v = calloc((size_t)cap, sizeof(double));
+    tr->cap = cap;
+    tr->n = tr->head = 0;
+    return (tr->t && tr->v) ? 0 : -1;
+}
+
+static void trend_free(trend_t *tr) {
+    free(tr->t);
+    free(tr->v);
+    tr->t = tr->v = NULL;
+}
+
+static void trend_push(trend_t *tr, double t, double v) {
+    tr->t[tr->head] = t;
+    tr->v[tr->head] = v;
+    tr->head = (tr->head + 1) % tr->cap;
+    if (tr->n < tr->cap)
+        tr->n++;
+}
+
+/* i-th oldest sample */
+static int trend_at(const trend_t *tr, int i) {
+    return (tr->head - tr->n + i + tr->cap) % tr->cap;
+}
+
+/* Least-squares slope over the window in kB/s, 0 with fewer than 2 samples */
+static double trend_slope(const trend_t *tr) {
+    if (tr->n < 2)
+        return 0.0;
+    double st = 0, sv = 0, stt = 0, stv = 0;
+    for (int i = 0; i < tr->n; i++) {
+        int k = trend_at(tr, i);
+        st += tr->t[k];
+        sv += tr->v[k];
+        stt += tr->t[k] * tr->t[k];
+        stv += tr->t[k] * tr->v[k];
+    }
+    double den = tr->n * stt - st * st;
+    return den != 0.0 ? (tr->n * stv - st * sv) / den : 0.0;
+}
+
+/* Full window, never shrank, grew in at least half the steps */
+static int trend_leaking(const trend_t *tr) {
+    if (tr->n < tr->cap || tr->cap < 3)
+        return 0;
+    int grew = 0;
+    for (int i = 1; i < tr->n; i++) {
+        double d = tr->v[trend_at(tr, i)] - tr->v[trend_at(tr, i - 1)];
+        if (d < 0)
+            return 0;
+        if (d > 0)
+            grew++;
+    }
+    return grew * 2 >= tr->n - 1;
+}
+
+static void wseries_update(wseries_t *s, double t, double v) {
+    s->delta = s->tr.n ? v - s->last : 0.0;
+    s->last = v;
+    s->seen = 1;
+    trend_push(&s->tr, t, v);
+}
+
+typedef struct {
+    const char *label;
+    int mi;                         /* meminfo field, -1 for vmallocinfo */
+} wcat_t;
+
+static const wcat_t watch_cats[] = {
+    { "Slab",          MI_SLAB },
+    { "SReclaimable",  MI_SRECLAIMABLE },
+    { "SUnreclaim",    MI_SUNRECLAIM },
+    { "PageTables",    MI_PAGE_TABLES },
+    { "KernelStack",   MI_KERNEL_STACK },
+    { "VmallocUsed",   MI_VMALLOC_USED },
+    { "Vmalloc pages", -1 },
+    { "Percpu",        MI_PERCPU },
+};
+#define WATCH_NCATS (sizeof(watch_cats) / sizeof(watch_cats[0]))
+
+static const char *const compact_keys[] = {
+    "compact_stall", "compact_fail", "compact_success", "compact_migrate_scanned",
+    "compact_free_scanned", "compact_isolated", "compact_daemon_wake",
+    "thp_fault_alloc", "thp_fault_fallback", "thp_collapse_alloc", "thp_collapse_alloc_failed",
+};
+#define COMPACT_NKEYS (sizeof(compact_keys) / sizeof(compact_keys[0]))
+
+typedef struct {
+    int fd_meminfo;
+    int fd_slabinfo;
+    int fd_vmalloc;
+    char *buf;
+    size_t cap;
+    int window;
+    wseries_t cat[WATCH_NCATS];
+    wseries_t *caches;
+    size_t ncaches;
+    size_t capc;
+    int fd_alloc;                   /* /proc/allocinfo with --alloc-sites, else -1 */
+    alloc_agg_t alloc_prev;         /* previous sample */
+    int alloc_seen;
+    int fd_buddy;                   /* /proc/buddyinfo with --frag, else -1 */
+    int fd_vmstat;
+    int pageblock_order;
+    long long compact_prev[COMPACT_NKEYS];
+    int compact_seen;
+} watch_t;
+
+/* Series for a slab cache; slabinfo order is stable so try the hint first */
+static wseries_t *watch_cache(watch_t *w, const char *name, size_t hint) {
+    if (hint < w->ncaches && strcmp(w->caches[hint].name, name) == 0)
+        return &w->caches[hint];
+    for (size_t i = 0; i < w->ncaches; i++) {
+        if (strcmp(w->caches[i].name, name) == 0)
+            return &w->caches[i];
+    }
+    if (w->ncaches == w->capc) {
+        size_t ncap = w->capc ? w->capc * 2 : 256;
+        wseries_t *nc = realloc(w->caches, ncap * sizeof(*nc));
+        if (!nc)
+            return NULL;
+        w->caches = nc;
+        w->capc = ncap;
+    }
+    wseries_t *s = &w->caches[w->ncaches];
+    memset(s, 0, sizeof(*s));
+    snprintf(s->name, sizeof(s->name), "%s", name);
+    if (trend_init(&s->tr, w->window) != 0)
+        return NULL;
+    w->ncaches++;
+    return s;
+}
+
+static int cmp_abs_delta(const void *a, const void *b) {
+    double x = (*(wseries_t *const *)a)->delta;
+    double y = (*(wseries_t *const *)b)->delta;
+    if (x < 0) x = -x;
+    if (y < 0) y = -y;
+    return (x < y) - (x > y);
+}
+
+typedef struct {
+    const char *key;
+    unsigned long long bytes;      /* now; 0 when the key vanished */
+    long long delta;
+} alloc_delta_t;
+
+static int cmp_alloc_delta(const void *a, const void *b) {
+    long long x = ((const alloc_delta_t *)a)->delta;
+    long long y = ((const alloc_delta_t *)b)->delta;
+    if (x < 0) x = -x;
+    if (y < 0) y = -y;
+    return (x < y) - (x > y);
+}
+
+/* Keys of one allocinfo table whose live bytes changed since the last sample */
+static void watch_alloc_diff(const agg_t *now, const agg_t *old, const char *by,
+                             double dt, int top) {
+    size_t n = 0;
+    alloc_delta_t *d = malloc((now->n + old->n + 1) * sizeof(*d));
+    for (size_t i = 0; d && i < now->cap; i++) {
+        const agg_entry_t *e = &now->slot[i];
+        if (!e->key[0])
+            continue;
+        const agg_entry_t *o = agg_get((agg_t *)old, e->key, strlen(e->key), 0);
+        long long dv = (long long)e->bytes - (o ? (long long)o->bytes : 0);
+        if (dv != 0)
+            d[n++] = (alloc_delta_t){ e->key, e->bytes, dv };
+    }
+    for (size_t i = 0; d && i < old->cap; i++) {
+        const agg_entry_t *o = &old->slot[i];
+        if (o->key[0] && o->bytes && !agg_get((agg_t *)now, o->key, strlen(o->key), 0))
+            d[n++] = (alloc_delta_t){ o->key, 0, -(long long)o->bytes };
+    }
+    if (n > 0) {
+        qsort(d, n, sizeof(*d), cmp_alloc_delta);
+        printf("  Allocation sites changed (by %s): %zu\n", by, n);
+        for (size_t i = 0; i < n && (int)i < top; i++)
+            printf("    %-24s %12.0f %+10.0f %+10.1f\n", d[i].key, d[i].bytes / 1024.0,
+                   d[i].delta / 1024.0, dt > 0 ? d[i].delta / 1024.0 / dt : 0.0);
+    }
+    free(d);
+}
+
+/* Modules, files and functions whose live bytes in /proc/allocinfo changed */
+static void watch_alloc(watch_t *w, double dt, int top) {
+    if (pread_all(w->fd_alloc, &w->buf, &w->cap) < 0)
+        return;
+    alloc_agg_t cur = {0};
+    alloc_parse(w->buf, &cur);
+
+    if (w->alloc_seen) {
+        watch_alloc_diff(&cur.by_module, &w->alloc_prev.by_module, "module", dt, top);
+        watch_alloc_diff(&cur.by_file, &w->alloc_prev.by_file, "file", dt, top);
+        watch_alloc_diff(&cur.by_func, &w->alloc_prev.by_func, "function", dt, top);
+    }
+
+    alloc_free(&w->alloc_prev);
+    w->alloc_prev = cur;
+    w->alloc_seen = 1;
+}
+
+/* Fragmentation over all zones and the compaction/THP counters */
+static void watch_frag(watch_t *w, const meminfo_t *mi) {
+    long kpp = sysconf(_SC_PAGESIZE) / 1024;
+    if (pread_all(w->fd_buddy, &w->buf, &w->cap) >= 0) {
+        frag_t *f = calloc(1, sizeof(*f));
+        if (f) {
+            f->pageblock_order = w->pageblock_order;
+            frag_parse_buddyinfo(w->buf, f);
+            unsigned long all[FRAG_MAX_ORDER] = {0};
+            for (int i = 0; i < f->nzones; i++) {
+                for (int o = 0; o < f->norders; o++)
+                    all[o] += f->z[i].free[o];
+            }
+            int thp = frag_thp_order(f, mi);
+            unsigned long long free_pages = frag_free_pages(all, f->norders);
+            unsigned long long bad = frag_unusable_pages(all, f->norders, thp);
+            double fi = frag_index(all, f->norders, thp);
+            printf("  Buddy: %llu kB free, %llu kB (%.1f%%) unusable for order-%d",
+                   free_pages * kpp, bad * kpp, free_pages ? 100.0 * bad / free_pages : 0.0, thp);
+            if (fi >= 0)
+                printf(", frag index %.3f", fi);
+            printf("\n");
+            free(f);
+        }
+    }
+
+    if (w->fd_vmstat < 0 || pread_all(w->fd_vmstat, &w->buf, &w->cap) < 0)
+        return;
+    /* One line per group of counters present: compaction, then THP */
+    int group = -1;
+    for (size_t i = 0; i < COMPACT_NKEYS; i++) {
+        long long v = vmstat_get(w->buf, compact_keys[i]);
+        if (v < 0)
+            continue;
+        int thp = strncmp(compact_keys[i], "thp_", 4) == 0;
+        if (thp != group) {
+            if (group >= 0)
+                printf("\n");
+            printf("  %s", thp ? "THP:       " : "Compaction:");
+            group = thp;
+        }
+        printf(" %s %lld", compact_keys[i] + (thp ? 4 : 8), v);
+        if (w->compact_seen)
+            printf(" (%+lld)", v - w->compact_prev[i]);
+        w->compact_prev[i] = v;
+    }
+    if (group >= 0)
+        printf("\n");
+    w->compact_seen = 1;
+}
+
+static void watch_sample(watch_t *w, double t, double dt, meminfo_t *mi, int top) {
+    long page_size = sysconf(_SC_PAGESIZE);
+
+    /* Categories: one pread of meminfo, one of vmallocinfo */
+    long vm_pages_kb = -1;
+    if (pread_all(w->fd_meminfo, &w->buf, &w->cap) >= 0)
+        meminfo_parse(w->buf, mi);
+    if (w->fd_vmalloc >= 0 && pread_all(w->fd_vmalloc, &w->buf, &w->cap) >= 0)
+        vm_pages_kb = vmallocinfo_pages_kb(w->buf);
+
+    time_t now = time(NULL);
+    char stamp[32];
+    strftime(stamp, sizeof(stamp), "%H:%M:%S", localtime(&now));
+    printf("\n--- %s  t=%.1f s ---\n", stamp, t);
+    printf("  %-14s %12s %10s %10s %11s\n", "Category", "kB", "Delta kB", "kB/s", "Trend kB/s");
+
+    for (size_t i = 0; i < WATCH_NCATS; i++) {
+        long v = watch_cats[i].mi >= 0 ? mi->v[watch_cats[i].mi] : vm_pages_kb;
+        if (v < 0)
+            continue;
+        wseries_t *s = &w->cat[i];
+        wseries_update(s, t, (double)v);
+        printf("  %-14s %12ld %+10.0f %+10.1f %+11.2f\n", watch_cats[i].label, v,
+               s->delta, dt > 0 ? s->delta / dt : 0.0, trend_slope(&s->tr));
+    }
+
+    /* Slab caches */
+    slab_list_t sl = {0};
+    int have_slab;
+    if (w->fd_slabinfo >= 0) {
+        have_slab = pread_all(w->fd_slabinfo, &w->buf, &w->cap) >= 0;
+        if (have_slab)
+            slab_parse_slabinfo(w->buf, &sl, page_size);
+    } else {
+        have_slab = slab_collect(&sl) == 0;
+    }
+
+    if (have_slab) {
+        for (size_t i = 0; i < w->ncaches; i++)
+            w->caches[i].seen = 0;
+        for (size_t i = 0; i < sl.n; i++) {
+            wseries_t *s = watch_cache(w, sl.c[i].name, i);
+            if (s)
+                wseries_update(s, t, sl.c[i].total_bytes / 1024.0);
+        }
+
+        wseries_t **order = malloc(w->ncaches * sizeof(*order));
+        size_t n = 0;
+        for (size_t i = 0; order && i < w->ncaches; i++) {
+            if (w->caches[i].seen && w->caches[i].delta != 0.0)
+                order[n++] = &w->caches[i];
+        }
+        if (n > 0) {
+            qsort(order, n, sizeof(*order), cmp_abs_delta);
+            printf("  Slab caches changed: %zu\n", n);
+            for (size_t i = 0; i < n && (int)i < top; i++)
+                printf("    %-24s %12.0f %+10.0f %+10.1f %+11.2f\n", order[i]->name,
+                       order[i]->last, order[i]->delta,
+                       dt > 0 ? order[i]->delta / dt : 0.0, trend_slope(&order[i]->tr));
+        }
+        free(order);
+    }
+    slab_free(&sl);
+
+    if (w->fd_alloc >= 0)
+        watch_alloc(w, dt, top);
+    if (w->fd_buddy >= 0)
+        watch_frag(w, mi);
+
+    /* Leak suspects over the full window */
+    for (size_t i = 0; i < WATCH_NCATS; i++) {
+        const trend_t *tr = &w->cat[i].tr;
+        if (trend_leaking(tr))
+            printf("  [!] Suspected leak: %s grew %+.0f kB over %.0f s (%+.2f kB/s)\n",
+                   watch_cats[i].label, tr->v[trend_at(tr, tr->n - 1)] - tr->v[trend_at(tr, 0)],
+                   tr->t[trend_at(tr, tr->n - 1)] - tr->t[trend_at(tr, 0)], trend_slope(tr));
+    }
+    for (size_t i = 0; i < w->ncaches; i++) {
+        const trend_t *tr = &w->caches[i].tr;
+        if (w->caches[i].seen && trend_leaking(tr))
+            printf("  [!] Suspected leak: slab %s grew %+.0f kB over %.0f s (%+.2f kB/s)\n",
+                   w->caches[i].name,
+                   tr->v[trend_at(tr, tr->n - 1)] - tr->v[trend_at(tr, 0)],
+                   tr->t[trend_at(tr, tr->n - 1)] - tr->t[trend_at(tr, 0)], trend_slope(tr));
+    }
+    fflush(stdout);
+}
+
+/* Sleep in seconds (double) */
+static void sleep_double(double secs) {
+    if (secs <= 0) return;
+    struct timespec ts;
+    ts.tv_sec = (time_t)secs;
+    ts.tv_nsec = (long)((secs - ts.tv_sec) * 1e9);
+    if (ts.tv_nsec < 0) ts.tv_nsec = 0;
+    nanosleep(&ts, NULL);
+}
+
+static int run_watch(double interval, long count, int window, int top, int alloc, int frag) {
+    watch_t w;
+    memset(&w, 0, sizeof(w));
+    w.window = window;
+    w.fd_meminfo = open(MEMINFO_PATH, O_RDONLY | O_CLOEXEC);
+    if (w.fd_meminfo < 0) {
+        fprintf(stderr, "Cannot open %s\n", MEMINFO_PATH);
+        return 1;
+    }
+    w.fd_slabinfo = open(SLABINFO_PATH, O_RDONLY | O_CLOEXEC);
+    w.fd_vmalloc = open(VMALLOCINFO_PATH, O_RDONLY | O_CLOEXEC);
+    w.fd_alloc = -1;
+    if (alloc) {
+        w.fd_alloc = open(ALLOCINFO_PATH, O_RDONLY | O_CLOEXEC);
+        if (w.fd_alloc < 0)
+            alloc_unavailable(errno);
+    }
+    w.fd_buddy = w.fd_vmstat = -1;
+    if (frag) {
+        frag_t *f = calloc(1, sizeof(*f));
+        w.pageblock_order = (f && frag_collect(f) == 0) ? f->pageblock_order : -1;
+        free(f);
+        w.fd_buddy = open(BUDDYINFO_PATH, O_RDONLY | O_CLOEXEC);
+        w.fd_vmstat = open(VMSTAT_PATH, O_RDONLY | O_CLOEXEC);
+        if (w.fd_buddy < 0)
+            fprintf(stderr, "Cannot open %s\n", BUDDYINFO_PATH);
+    }
+    for (size_t i = 0; i < WATCH_NCATS; i++) {
+        snprintf(w.cat[i].name, sizeof(w.cat[i].name), "%s", watch_cats[i].label);
+        if (trend_init(&w.cat[i].tr, window) != 0) {
+            fprintf(stderr, "Out of memory\n");
+            return 1;
+        }
+    }
+
+    printf("kernmem: watching every %.2f s, leak window %d samples (%.0f s)%s\n",
+           interval, window, interval * (window - 1),
+           w.fd_slabinfo < 0 ? ", slab caches from " SLAB_SYSFS : "");
+
+    meminfo_t mi = {0};
+    struct timespec t0, tn;
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    double prev = 0.0;
+    for (long i = 0; count == 0 || i < count; i++) {
+        if (i > 0)
+            sleep_double(interval);
+        clock_gettime(CLOCK_MONOTONIC, &tn);
+        double t = (tn.tv_sec - t0.tv_sec) + (tn.tv_nsec - t0.tv_nsec) / 1e9;
+        watch_sample(&w, t, t - prev, &mi, top);
+        prev = t;
+    }
+
+    meminfo_free(&mi);
+    for (size_t i = 0; i < WATCH_NCATS; i++)
+        trend_free(&w.cat[i].tr);
+    for (size_t i = 0; i < w.ncaches; i++)
+        trend_free(&w.caches[i].tr);
+    free(w.caches);
+    alloc_free(&w.alloc_prev);
+    free(w.buf);
+    close(w.fd_meminfo);
+    if (w.fd_slabinfo >= 0) close(w.fd_slabinfo);
+    if (w.fd_vmalloc >= 0) close(w.fd_vmalloc);
+    if (w.fd_alloc >= 0) close(w.fd_alloc);
+    if (w.fd_buddy >= 0) close(w.fd_buddy);
+    if (w.fd_vmstat >= 0) close(w.fd_vmstat);
+    return 0;
+}
+
+/* ---------- vmalloc by caller ---------- */
+
+/*
+ * --vmalloc reads /proc/vmallocinfo in one go and aggregates every area
+ * ("start-end size caller+off/len [pages=N] [phys=..] flags... [N0=..]")
+ * by caller function (an agg_t) and by type.  The size column includes
+ * the guard page; pages= is what is actually allocated, and its sum is the
+ * vmalloc total even where meminfo reports VmallocUsed as 0.
+ */
+typedef struct {
+    const char *name;
+    unsigned long long bytes;
+    unsigned long long pages;
+    long areas;
+} vm_type_t;
+
+typedef struct {
+    agg_t callers;                 /* bytes, units = pages, n = areas */
+    vm_type_t types[8];
+    long vpages;                   /* areas whose page array is vmalloc'ed too */
+    unsigned long long total_pages;
+    long total_areas;
+} vm_agg_t;
+
+static const char *const vm_type_names[] = {
+    "vmalloc", "ioremap", "vmap", "user", "vm_map_ram", "dma-coherent", "unpurged", "other"
+};
+#define VM_NTYPES (sizeof(vm_type_names) / sizeof(vm_type_names[0]))
+
+static int vm_collect(vm_agg_t *a) {
+    char *buf = read_whole(VMALLOCINFO_PATH);
+    if (!buf)
+        return -1;
+    for (size_t i = 0; i < VM_NTYPES; i++)
+        a->types[i].name = vm_type_names[i];
+
+    char *save;
+    for (char *line = strtok_r(buf, "\n", &save); line; line = strtok_r(NULL, "\n", &save)) {
+        /* range, size, caller */
+        char *p = strchr(line, ' ');
+        if (!p)
+            continue;
+        unsigned long long size = strtoull(p, &p, 10);
+        while (*p == ' ')
+            p++;
+        char *caller = p;
+        size_t clen = strcspn(caller, " +");
+        p = caller + strcspn(caller, " ");
+
+        unsigned long long pages = 0;
+        int type = (int)VM_NTYPES - 1;
+        int vpages = 0;
+        for (char *tok = p; *tok; ) {
+            while (*tok == ' ')
+                tok++;
+            size_t tl = strcspn(tok, " ");
+            if (tl == 0)
+                break;
+            if (strncmp(tok, "pages=", 6) == 0) {
+                pages = strtoull(tok + 6, NULL, 10);
+            } else if (tl == 6 && strncmp(tok, "vpages", 6) == 0) {
+                vpages = 1;
+            } else if (type == (int)VM_NTYPES - 1) {
+                for (size_t t = 0; t + 1 < VM_NTYPES; t++) {
+                    if (strlen(vm_type_names[t]) == tl && strncmp(tok, vm_type_names[t], tl) == 0)
+                        type = (int)t;
+                }
+            }
+            tok += tl;
+        }
+        /* "unpurged vm_area" (lazily freed) and "vm_map_ram" areas have no caller */
+        if (clen == 8 && strncmp(caller, "unpurged", 8) == 0)
+            type = 6;
+        else if (clen == 10 && strncmp(caller, "vm_map_ram", 10) == 0)
+            type = 4;
+
+        agg_add(&a->callers, caller, clen, size, pages);
+        a->types[type].bytes += size;
+        a->types[type].pages += pages;
+        a->types[type].areas++;
+        a->vpages += vpages;
+        a->total_pages += pages;
+        a->total_areas++;
+    }
+    free(buf);
+    return 0;
+}
+
+static void print_vmalloc(const vm_agg_t *a, int top, const meminfo_t *mi) {
+    long kpp = sysconf(_SC_PAGESIZE) / 1024;
+    size_t shown = (top > 0 && (size_t)top < a->callers.n) ? (size_t)top : a->callers.n;
+    printf("\nvmalloc (%s): %ld areas, %llu kB backed by pages (VmallocUsed %ld kB)\n",
+           VMALLOCINFO_PATH, a->total_areas, a->total_pages * kpp, mi->v[MI_VMALLOC_USED]);
+    printf("  %-14s %8s %12s %12s\n", "Type", "Areas", "Size kB", "Pages kB");
+    for (size_t i = 0; i < VM_NTYPES; i++) {
+        if (a->types[i].areas)
+            printf("  %-14s %8ld %12llu %12llu\n", a->types[i].name, a->types[i].areas,
+                   a->types[i].bytes / 1024, a->types[i].pages * kpp);
+    }
+    if (a->vpages)
+        printf("  (%ld area(s) with a vmalloc'ed page array: vpages)\n", a->vpages);
+
+    printf("  Top %zu of %zu callers by size:\n", shown, a->callers.n);
+    printf("  %-40s %8s %12s %12s\n", "Caller", "Areas", "Size kB", "Pages kB");
+    for (size_t i = 0; i < shown; i++)
+        printf("  %-40s %8ld %12llu %12llu\n", a->callers.slot[i].key, a->callers.slot[i].n,
+               a->callers.slot[i].bytes / 1024, a->callers.slot[i].units * kpp);
+}
+
+static void print_vmalloc_json(const vm_agg_t *a, int top) {
+    long kpp = sysconf(_SC_PAGESIZE) / 1024;
+    size_t shown = (top > 0 && (size_t)top < a->callers.n) ? (size_t)top : a->callers.n;
+    printf(",\n  \"vmalloc\": {\"areas\": %ld, \"pages_kb\": %llu, \"vpages\": %ld, \"types\": {",
+           a->total_areas, a->total_pages * kpp, a->vpages);
+    int first = 1;
+    for (size_t i = 0; i < VM_NTYPES; i++) {
+        if (!a->types[i].areas)
+            continue;
+        printf("%s\"%s\": {\"areas\": %ld, \"size_kb\": %llu, \"pages_kb\": %llu}",
+               first ? "" : ", ", a->types[i].name, a->types[i].areas,
+               a->types[i].bytes / 1024, a->types[i].pages * kpp);
+        first = 0;
+    }
+    printf("}, \"top\": [");
+    for (size_t i = 0; i < shown; i++) {
+        printf("%s\n    {\"caller\": ", i ? "," : "");
+        json_put_str(stdout, a->callers.slot[i].key);
+        printf(", \"areas\": %ld, \"size_kb\": %llu, \"pages_kb\": %llu}",
+               a->callers.slot[i].n, a->callers.slot[i].bytes / 1024,
+               a->callers.slot[i].units * kpp);
+    }
+    printf("\n  ]}");
+}
+
+/*
+ * 1 if thread stacks are vmalloc'd (CONFIG_VMAP_STACK), so KernelStack is
+ * also inside VmallocUsed; 0 if not.  The build config answers directly;
+ * without it, stack areas show up in vmallocinfo under the stack allocator
+ * (or copy_process, where it is inlined).
+ */
+static int kstack_vmapped(void) {
+    struct utsname uts;
+    if (uname(&uts) == 0) {
+        char path[512];
+        snprintf(path, sizeof(path), "/boot/config-%s", uts.release);
+        FILE *fp = fopen(path, "r");
+        if (fp) {
+            char line[256];
+            int vmap = 0;
+            while (fgets(line, sizeof(line), fp)) {
+                if (strncmp(line, "CONFIG_VMAP_STACK=y", 19) == 0) {
+                    vmap = 1;
+                    break;
+                }
+            }
+            fclose(fp);
+            return vmap;
+        }
+    }
+    char *buf = read_whole(VMALLOCINFO_PATH);
+    if (!buf)
+        return 0;
+    int vmap = strstr(buf, " alloc_thread_stack_node+") != NULL ||
+               strstr(buf, " copy_process+") != NULL;
+    free(buf);
+    return vmap;
+}
+
+/* ---------- Per-NUMA-node accounting ---------- */
+
+/*
+ * --numa parses /sys/devices/system/node/node<N>/meminfo with the same
+ * snapshot parser as /proc/meminfo ("Node N " prefixes are skipped), and
+ * node<N>/vmstat for what that lacks on older kernels.  vmalloc-backed
+ * pages per node are the N<node>= counts of /proc/vmallocinfo, less the
+ * node's KernelStack when stacks are vmalloc'd.  Percpu is
+ * only reported system-wide; each CPU's unit lives on its own node, so it
+ * is apportioned by CPU count and marked as an estimate.
+ */
+#define NODE_SYSFS     "/sys/devices/system/node"
+#define NUMA_MAX_NODES 64
+
+typedef struct {
+    int  node;
+    int  ncpus;
+    long mem_total, mem_free;
+    long slab, sreclaimable, sunreclaim;
+    long page_tables, sec_page_tables, kernel_stack;
+    long vmalloc;                  /* kB from vmallocinfo, -1 if unreadable */
+    long percpu;                   /* kB, apportioned estimate */
+} numa_node_t;
+
+/* Number of CPUs in a cpulist such as "0-3,8-11" */
+static int cpulist_count(const char *s) {
+    int n = 0;
+    while (s && *s) {
+        char *end;
+        long a = strtol(s, &end, 10);
+        if (end == s)
+            break;
+        long b = a;
+        if (*end == '-')
+            b = strtol(end + 1, &end, 10);
+        n += (int)(b - a + 1);
+        s = (*end == ',') ? end + 1 : NULL;
+    }
+    return n;
+}
+
+/* Sum the N<node>=pages of every vmallocinfo area into node_kb[] */
+static int vmallocinfo_node_kb(long node_kb[NUMA_MAX_NODES]) {
+    char *buf = read_whole(VMALLOCINFO_PATH);
+    if (!buf)
+        return -1;
+    long kb_per_page = sysconf(_SC_PAGESIZE) / 1024;
+    for (const char *p = buf; (p = strstr(p, " N")) != NULL; p += 2) {
+        char *end;
+        long node = strtol(p + 2, &end, 10);
+        if (end == p + 2 || *end != '=' || node < 0 || node >= NUMA_MAX_NODES)
+            continue;
+        node_kb[node] += strtol(end + 1, NULL, 10) * kb_per_page;
+    }
+    free(buf);
+    return 0;
+}
+
+static int numa_node_cmp(const void *a, const void *b) {
+    return ((const numa_node_t *)a)->node - ((const numa_node_t *)b)->node;
+}
+
+static int numa_collect(numa_node_t *nodes, int *nnodes, long percpu_kb) {
+    DIR *dp = opendir(NODE_SYSFS);
+    if (!dp)
+        return -1;
+
+    long vm_kb[NUMA_MAX_NODES] = {0};
+    int have_vm = vmallocinfo_node_kb(vm_kb) == 0;
+    int vmap_stacks = have_vm && kstack_vmapped();
+    meminfo_t mi = {0};
+    int n = 0, cpus = 0;
+    struct dirent *de;
+
+    while ((de = readdir(dp)) != NULL && n < NUMA_MAX_NODES) {
+        int node;
+        char tail;
+        if (sscanf(de->d_name, "node%d%c", &node, &tail) != 1 ||
+            node < 0 || node >= NUMA_MAX_NODES)
+            continue;
+
+        char path[128];
+        snprintf(path, sizeof(path), NODE_SYSFS "/node%d/meminfo", node);
+        char *buf = read_whole(path);
+        if (!buf)
+            continue;
+        meminfo_parse(buf, &mi);
+        free(buf);
+
+        numa_node_t *nd = &nodes[n++];
+        memset(nd, 0, sizeof(*nd));
+        nd->node = node;
+        nd->mem_total       = mi.v[MI_MEM_TOTAL];
+        nd->mem_free        = mi.v[MI_MEM_FREE];
+        nd->slab            = mi.v[MI_SLAB];
+        nd->sreclaimable    = mi.v[MI_SRECLAIMABLE];
+        nd->sunreclaim      = mi.v[MI_SUNRECLAIM];
+        nd->page_tables     = mi.v[MI_PAGE_TABLES];
+        nd->sec_page_tables = mi.v[MI_SEC_PAGE_TABLES];
+        nd->kernel_stack    = mi.v[MI_KERNEL_STACK];
+        nd->vmalloc         = have_vm ? vm_kb[node] : -1;
+
+        /* Older kernels: fill the gaps from the node's vmstat (pages) */
+        snprintf(path, sizeof(path), NODE_SYSFS "/node%d/vmstat", node);
+        if ((buf = read_whole(path)) != NULL) {
+            long kpp = sysconf(_SC_PAGESIZE) / 1024;
+            long long v;
+            if (nd->sreclaimable < 0 && (v = vmstat_get(buf, "nr_slab_reclaimable")) >= 0)
+                nd->sreclaimable = (long)v * kpp;
+            if (nd->sunreclaim < 0 && (v = vmstat_get(buf, "nr_slab_unreclaimable")) >= 0)
+                nd->sunreclaim = (long)v * kpp;
+            if (nd->slab < 0 && nd->sreclaimable >= 0 && nd->sunreclaim >= 0)
+                nd->slab = nd->sreclaimable + nd->sunreclaim;
+            if (nd->page_tables < 0 && (v = vmstat_get(buf, "nr_page_table_pages")) >= 0)
+                nd->page_tables = (long)v * kpp;
+            if (nd->sec_page_tables < 0 && (v = vmstat_get(buf, "nr_sec_page_table_pages")) >= 0)
+                nd->sec_page_tables = (long)v * kpp;
+            if (nd->kernel_stack < 0 && (v = vmstat_get(buf, "nr_kernel_stack")) >= 0)
+                nd->kernel_stack = (long)v;       /* already kB */
+            free(buf);
+        }
+        if (vmap_stacks && nd->vmalloc >= 0 && nd->kernel_stack > 0)
+            nd->vmalloc = kb_or_zero(nd->vmalloc - nd->kernel_stack);
+
+        snprintf(path, sizeof(path), NODE_SYSFS "/node%d/cpulist", node);
+        if ((buf = read_whole(path)) != NULL) {
+            nd->ncpus = cpulist_count(buf);
+            cpus += nd->ncpus;
+            free(buf);
+        }
+    }
+    closedir(dp);
+    meminfo_free(&mi);
+
+    for (int i = 0; i < n; i++)
+        nodes[i].percpu = (percpu_kb >= 0 && cpus > 0)
+                        ? percpu_kb * nodes[i].ncpus / cpus : -1;
+    qsort(nodes, (size_t)n, sizeof(nodes[0]), numa_node_cmp);
+    *nnodes = n;
+    return n > 0 ? 0 : -1;
+}
+
+/* Kernel memory attributed to a node: every known column */
+static long numa_kernel_kb(const numa_node_t *nd) {
+    long parts[] = { nd->slab, nd->page_tables, nd->sec_page_tables,
+                     nd->kernel_stack, nd->vmalloc, nd->percpu };
+    long sum = 0;
+    for (size_t i = 0; i < sizeof(parts) / sizeof(parts[0]); i++)
+        sum += parts[i] > 0 ? parts[i] : 0;
+    return sum;
+}
+
+static void print_numa(const numa_node_t *nodes, int n) {
+    printf("\nPer-node kernel memory (%s), kB:\n", NODE_SYSFS);
+    printf("  %-5s %11s %11s %10s %10s %10s %10s %8s %8s %9s %9s %11s %6s\n",
+           "Node", "MemTotal", "MemFree", "Slab", "SReclaim", "SUnreclaim", "PageTables",
+           "SecPT", "KStack", "Vmalloc", "Percpu~", "Kernel", "%Node");
+    for (int i = 0; i < n; i++) {
+        const numa_node_t *nd = &nodes[i];
+        long k = numa_kernel_kb(nd);
+        printf("  %-5d", nd->node);
+        print_kb_col(nd->mem_total >= 0 ? nd->mem_total * 1024 : -1, 11);
+        print_kb_col(nd->mem_free >= 0 ? nd->mem_free * 1024 : -1, 11);
+        print_kb_col(nd->slab >= 0 ? nd->slab * 1024 : -1, 10);
+        print_kb_col(nd->sreclaimable >= 0 ? nd->sreclaimable * 1024 : -1, 10);
+        print_kb_col(nd->sunreclaim >= 0 ? nd->sunreclaim * 1024 : -1, 10);
+        print_kb_col(nd->page_tables >= 0 ? nd->page_tables * 1024 : -1, 10);
+        print_kb_col(nd->sec_page_tables >= 0 ? nd->sec_page_tables * 1024 : -1, 8);
+        print_kb_col(nd->kernel_stack >= 0 ? nd->kernel_stack * 1024 : -1, 8);
+        print_kb_col(nd->vmalloc >= 0 ? nd->vmalloc * 1024 : -1, 9);
+        print_kb_col(nd->percpu >= 0 ? nd->percpu * 1024 : -1, 9);
+        printf(" %11ld %5.1f%%\n", k, nd->mem_total > 0 ? 100.0 * k / nd->mem_total : 0.0);
+    }
+    printf("  (Percpu~ is the system Percpu split by CPUs per node)\n");
+}
+
+static void print_numa_json(const numa_node_t *nodes, int n) {
+    printf(",\n  \"numa\": [");
+    for (int i = 0; i < n; i++) {
+        const numa_node_t *nd = &nodes[i];
+        printf("%s\n    {\"node\": %d, \"cpus\": %d, ", i ? "," : "", nd->node, nd->ncpus);
+        json_kb("mem_total_kb", nd->mem_total, ", ");
+        json_kb("mem_free_kb", nd->mem_free, ", ");
+        json_kb("slab_kb", nd->slab, ", ");
+        json_kb("sreclaimable_kb", nd->sreclaimable, ", ");
+        json_kb("sunreclaim_kb", nd->sunreclaim, ", ");
+        json_kb("page_tables_kb", nd->page_tables, ", ");
+        json_kb("sec_page_tables_kb", nd->sec_page_tables, ", ");
+        json_kb("kernel_stack_kb", nd->kernel_stack, ", ");
+        json_kb("vmalloc_kb", nd->vmalloc, ", ");
+        json_kb("percpu_est_kb", nd->percpu, ", ");
+        printf("\"kernel_kb\": %ld}", numa_kernel_kb(nd));
+    }
+    printf("\n  ]");
+}
+
+/* ---------- Physical page census ---------- */
+
+/*
+ * --census reads one 64-bit flag word per PFN from /proc/kpageflags (and
+ * the owning memcg inode from /proc/kpagecgroup) and puts every page in
+ * exactly one class, without going through meminfo's counters.
+ *
+ * Only PFNs backed by RAM are read: the "System RAM" ranges of /proc/iomem,
+ * or the online blocks under /sys/devices/system/memory when iomem hides
+ * its addresses.  Everything else up to the highest RAM PFN is a hole.
+ *
+ * The flags are read in CENSUS_CHUNK preads and classified in groups of
+ * CENSUS_GROUP PFNs, bit-sliced: each flag of interest becomes a bitmap
+ * with one bit per page, the classes are boolean expressions over those
+ * bitmaps, and counting is popcount.  Every page of a free buddy block
+ * carries KPF_BUDDY (since 4.6), so free pages need no folding.
+ */
+#define KPAGEFLAGS_PATH   "/proc/kpageflags"
+#define KPAGECGROUP_PATH  "/proc/kpagecgroup"
+#define ZONEINFO_PATH     "/proc/zoneinfo"
+#define IOMEM_PATH        "/proc/iomem"
+#define MEMORY_SYSFS      "/sys/devices/system/memory"
+#define CGROUP_ROOT       "/sys/fs/cgroup"
+#define CGROUP_V1_MEMORY  "/sys/fs/cgroup/memory"
+#define CENSUS_CHUNK      (1 << 19)     /* PFNs per pread: 4 MB of flags */
+#define CENSUS_GROUP      1024          /* PFNs per bitmap group */
+#define CENSUS_WORDS      (CENSUS_GROUP / 64)
+#define CENSUS_THREADS    8
+#define CENSUS_THREAD_MIN (1 << 20)     /* PFNs (4 GB) before threads are used */
+
+/* include/uapi/linux/kernel-page-flags.h */
+enum {
+    KPF_SLAB = 7, KPF_LRU = 5, KPF_BUDDY = 10, KPF_ANON = 12, KPF_SWAPBACKED = 14,
+    KPF_COMPOUND_HEAD = 15, KPF_COMPOUND_TAIL = 16, KPF_HUGE = 17, KPF_HWPOISON = 19,
+    KPF_NOPAGE = 20, KPF_KSM = 21, KPF_THP = 22, KPF_OFFLINE = 23, KPF_PGTABLE = 26,
+    KPF_RESERVED = 32
+};
+
+/* Bit slices: one bitmap per flag, plus compound (head or tail) and non-zero */
+enum {
+    SL_NOPAGE, SL_OFFLINE, SL_HWPOISON, SL_RESERVED, SL_BUDDY, SL_SLAB, SL_PGTABLE,
+    SL_HUGE, SL_ANON, SL_SWAPBACKED, SL_LRU, SL_THP, SL_KSM, SL_COMPOUND, SL_NONZERO,
+    SL_N
+};
+
+static const int slice_bit[SL_COMPOUND] = {
+    KPF_NOPAGE, KPF_OFFLINE, KPF_HWPOISON, KPF_RESERVED, KPF_BUDDY, KPF_SLAB, KPF_PGTABLE,
+    KPF_HUGE, KPF_ANON, KPF_SWAPBACKED, KPF_LRU, KPF_THP, KPF_KSM,
+};
+
+/* Exclusive classes, in the order they claim pages */
+enum {
+    CEN_OFFLINE, CEN_HWPOISON, CEN_RESERVED, CEN_FREE, CEN_SLAB, CEN_PGTABLE, CEN_HUGETLB,
+    CEN_ANON, CEN_SHMEM, CEN_FILE, CEN_NOFLAGS, CEN_OTHER,
+    CEN_N
+};
+
+static const char *const cen_label[CEN_N] = {
+    "Offline", "HWPoison", "Reserved", "Free (buddy)", "Slab", "Page tables", "HugeTLB",
+    "Anon", "Shmem", "File", "Kernel, no flags", "Other",
+};
+
+typedef struct {
+    uint64_t ino;                       /* 0 = empty slot */
+    unsigned long long pages;
+    unsigned long long kernel;          /* not anon, shmem, file or free */
+    char path[128];
+} cg_count_t;
+
+typedef struct {
+    cg_count_t *slot;
+    size_t cap;                         /* power of two */
+    size_t n;
+} cg_tab_t;
+
+typedef struct {
+    unsigned long long start, end;
+} pfn_range_t;
+
+typedef struct {
+    unsigned long long cls[CEN_N];
+    unsigned long long holes, thp, compound, ksm;
+    unsigned long long pfns;            /* PFNs read; after collection, PFNs spanned */
+    cg_tab_t cg;
+    int have_cg;
+    const char *ram_src;                /* where the RAM ranges came from, NULL if unknown */
+    size_t nranges;
+} census_t;
+
+static cg_count_t *cg_get(cg_tab_t *t, uint64_t ino) {
+    if ((t->n + 1) * 4 > t->cap * 3) {
+        size_t ncap = t->cap ? t->cap * 2 : 256;
+        cg_count_t *ns = calloc(ncap, sizeof(*ns));
+        if (!ns)
+            return NULL;
+        for (size_t i = 0; i < t->cap; i++) {
+            if (!t->slot[i].ino)
+                continue;
+            size_t k = (t->slot[i].ino * 0x9e3779b97f4a7c15ULL >> 32) & (ncap - 1);
+            while (ns[k].ino)
+                k = (k + 1) & (ncap - 1);
+            ns[k] = t->slot[i];
+        }
+        free(t->slot);
+        t->slot = ns;
+        t->cap = ncap;
+    }
+    size_t k = (ino * 0x9e3779b97f4a7c15ULL >> 32) & (t->cap - 1);
+    while (t->slot[k].ino && t->slot[k].ino != ino)
+        k = (k + 1) & (t->cap - 1);
+    if (!t->slot[k].ino) {
+        t->slot[k].ino = ino;
+        t->n++;
+    }
+    return &t->slot[k];
+}
+
+static void cg_add(cg_tab_t *t, uint64_t ino, unsigned long long pages, unsigned long long kernel) {
+    cg_count_t *c = cg_get(t, ino);
+    if (c) {
+        c->pages += pages;
+        c->kernel += kernel;
+    }
+}
+
+/* Give the pages of mask still in rem to a class; returns them */
+static inline uint64_t take(uint64_t *rem, uint64_t mask, unsigned long long *count) {
+    uint64_t x = mask & *rem;
+    *rem &= ~x;
+    *count += (unsigned long long)__builtin_popcountll(x);
+    return x;
+}
+
+/* Classify one group of CENSUS_GROUP pages; cg may be NULL */
+static void census_group(const uint64_t *flags, const uint64_t *cg, census_t *c) {
+    uint64_t m[SL_N][CENSUS_WORDS];
+    memset(m, 0, sizeof(m));
+
+    /* Slice: bit j of m[s][w] is flag s of page w * 64 + j */
+    for (unsigned w = 0; w < CENSUS_WORDS; w++) {
+        const uint64_t *f = flags + w * 64;
+        for (unsigned s = 0; s < SL_COMPOUND; s++) {
+            uint64_t acc = 0;
+            for (unsigned j = 0; j < 64; j++)
+                acc |= ((f[j] >> slice_bit[s]) & 1) << j;
+            m[s][w] = acc;
+        }
+        uint64_t comp = 0, nz = 0;
+        for (unsigned j = 0; j < 64; j++) {
+            comp |= (((f[j] >> KPF_COMPOUND_HEAD) | (f[j] >> KPF_COMPOUND_TAIL)) & 1) << j;
+            nz |= (uint64_t)(f[j] != 0) << j;
+        }
+        m[SL_COMPOUND][w] = comp;
+        m[SL_NONZERO][w] = nz;
+    }
+
+    uint64_t user[CENSUS_WORDS];
+    for (unsigned w = 0; w < CENSUS_WORDS; w++) {
+        uint64_t rem = ~m[SL_NOPAGE][w];
+        c->holes += (unsigned long long)__builtin_popcountll(m[SL_NOPAGE][w]);
+        take(&rem, m[SL_OFFLINE][w], &c->cls[CEN_OFFLINE]);
+        take(&rem, m[SL_HWPOISON][w], &c->cls[CEN_HWPOISON]);
+        take(&rem, m[SL_RESERVED][w], &c->cls[CEN_RESERVED]);
+        uint64_t u = take(&rem, m[SL_BUDDY][w], &c->cls[CEN_FREE]);
+        take(&rem, m[SL_SLAB][w], &c->cls[CEN_SLAB]);
+        take(&rem, m[SL_PGTABLE][w], &c->cls[CEN_PGTABLE]);
+        take(&rem, m[SL_HUGE][w], &c->cls[CEN_HUGETLB]);
+        u |= take(&rem, m[SL_ANON][w], &c->cls[CEN_ANON]);
+        u |= take(&rem, m[SL_SWAPBACKED][w], &c->cls[CEN_SHMEM]);
+        u |= take(&rem, m[SL_LRU][w], &c->cls[CEN_FILE]);
+        take(&rem, ~m[SL_NONZERO][w], &c->cls[CEN_NOFLAGS]);
+        take(&rem, rem, &c->cls[CEN_OTHER]);
+        user[w] = u | m[SL_NOPAGE][w];
+        c->thp += (unsigned long long)__builtin_popcountll(m[SL_THP][w] & ~m[SL_NOPAGE][w]);
+        c->compound += (unsigned long long)__builtin_popcountll(m[SL_COMPOUND][w] & ~m[SL_NOPAGE][w]);
+        c->ksm += (unsigned long long)__builtin_popcountll(m[SL_KSM][w] & ~m[SL_NOPAGE][w]);
+    }
+
+    if (!cg)
+        return;
+    /* Charged pages per memcg inode, folded in runs */
+    uint64_t ino = 0;
+    unsigned long long pages = 0, kernel = 0;
+    for (unsigned i = 0; i < CENSUS_GROUP; i++) {
+        if (cg[i] != ino) {
+            if (ino)
+                cg_add(&c->cg, ino, pages, kernel);
+            ino = cg[i];
+            pages = kernel = 0;
+        }
+        pages++;
+        kernel += !((user[i / 64] >> (i % 64)) & 1);
+    }
+    if (ino)
+        cg_add(&c->cg, ino, pages, kernel);
+}
+
+typedef struct {
+    int fd_flags, fd_cg;
+    pfn_range_t *r;                     /* this thread's share of the RAM ranges */
+    size_t nr;
+    census_t c;
+} census_job_t;
+
+/* Read and classify [start, end); 0 at the end of kpageflags */
+static int census_range(census_job_t *j, unsigned long long start, unsigned long long end,
+                        uint64_t *flags, uint64_t *cg) {
+    for (unsigned long long pfn = start; pfn < end; pfn += CENSUS_CHUNK) {
+        size_t want = (size_t)(end - pfn < CENSUS_CHUNK ? end - pfn : CENSUS_CHUNK);
+        ssize_t r = pread(j->fd_flags, flags, want * sizeof(uint64_t), (off_t)(pfn * sizeof(uint64_t)));
+        if (r <= 0)
+            return 0;
+        size_t n = (size_t)r / sizeof(uint64_t);
+        if (cg) {
+            ssize_t rc = pread(j->fd_cg, cg, n * sizeof(uint64_t), (off_t)(pfn * sizeof(uint64_t)));
+            if (rc < (ssize_t)(n * sizeof(uint64_t)))
+                memset((char *)cg + (rc > 0 ? rc : 0), 0, n * sizeof(uint64_t) - (rc > 0 ? (size_t)rc : 0));
+        }
+        /* Pad the last group with holes */
+        size_t padded = (n + CENSUS_GROUP - 1) / CENSUS_GROUP * CENSUS_GROUP;
+        for (size_t i = n; i < padded; i++) {
+            flags[i] = 1ULL << KPF_NOPAGE;
+            if (cg)
+                cg[i] = 0;
+        }
+        for (size_t g = 0; g < padded; g += CENSUS_GROUP)
+            census_group(flags + g, cg ? cg + g : NULL, &j->c);
+        j->c.holes -= padded - n;
+        j->c.pfns += n;
+        if (n < want)
+            return 0;
+    }
+    return 1;
+}
+
+static void *census_worker(void *arg) {
+    census_job_t *j = arg;
+    uint64_t *flags = malloc(CENSUS_CHUNK * sizeof(uint64_t));
+    uint64_t *cg = j->fd_cg >= 0 ? malloc(CENSUS_CHUNK * sizeof(uint64_t)) : NULL;
+    if (flags) {
+        j->c.have_cg = cg != NULL;
+        for (size_t i = 0; i < j->nr && census_range(j, j->r[i].start, j->r[i].end, flags, cg); i++)
+            ;
+    }
+    free(flags);
+    free(cg);
+    return NULL;
+}
+
+/* End of the highest zone, from its "spanned N" and "start_pfn: S" lines */
+static unsigned long long census_max_pfn(void) {
+    char *buf = read_whole(ZONEINFO_PATH);
+    if (!buf)
+        return 0;
+    unsigned long long max = 0, spanned = 0;
+    char *save;
+    for (char *line = strtok_r(buf, "\n", &save); line; line = strtok_r(NULL, "\n", &save)) {
+        while (*line == ' ')
+            line++;
+        if (strncmp(line, "spanned ", 8) == 0) {
+            spanned = strtoull(line + 8, NULL, 10);
+        } else if (strncmp(line, "start_pfn:", 10) == 0) {
+            unsigned long long end = strtoull(line + 10, NULL, 10) + spanned;
+            if (end > max)
+                max = end;
+        }
+    }
+    free(buf);
+    return max;
+}
+
+static int pfn_range_cmp(const void *a, const void *b) {
+    const pfn_range_t *x = a, *y = b;
+    return (x->start > y->start) - (x->start < y->start);
+}
+
+static int pfn_range_add(pfn_range_t **r, size_t *n, size_t *cap,
+                         unsigned long long start, unsigned long long end) {
+    if (end <= start)
+        return 0;
+    if (*n == *cap) {
+        size_t ncap = *cap ? *cap * 2 : 64;
+        pfn_range_t *nr = realloc(*r, ncap * sizeof(*nr));
+        if (!nr)
+            return -1;
+        *r = nr;
+        *cap = ncap;
+    }
+    (*r)[(*n)++] = (pfn_range_t){ start, end };
+    return 0;
+}
+
+/* Top-level "System RAM" ranges of /proc/iomem; none when addresses read as 0 */
+static size_t ram_ranges_iomem(pfn_range_t **r) {
+    char *buf = read_whole(IOMEM_PATH);
+    if (!buf)
+        return 0;
+    unsigned long long psize = (unsigned long long)sysconf(_SC_PAGESIZE);
+    size_t n = 0, cap = 0;
+    int nonzero = 0;
+    char *save;
+    for (char *line = strtok_r(buf, "\n", &save); line; line = strtok_r(NULL, "\n", &save)) {
+        unsigned long long start, end;
+        int off = 0;
+        if (line[0] == ' ' || sscanf(line, "%llx-%llx : %n", &start, &end, &off) != 2 || !off)
+            continue;
+        if (strcmp(line + off, "System RAM") != 0)
+            continue;
+        nonzero |= end != 0;
+        if (pfn_range_add(r, &n, &cap, (start + psize - 1) / psize, (end + 1) / psize) != 0)
+            break;
+    }
+    free(buf);
+    if (!nonzero) {
+        free(*r);
+        *r = NULL;
+        n = 0;
+    }
+    return n;
+}
+
+/* Online memory blocks, memory<N>/state under /sys/devices/system/memory */
+static size_t ram_ranges_sysfs(pfn_range_t **r) {
+    char *bs = read_whole(MEMORY_SYSFS "/block_size_bytes");
+    unsigned long long block = bs ? strtoull(bs, NULL, 16) : 0;
+    free(bs);
+    unsigned long long per = block / (unsigned long long)sysconf(_SC_PAGESIZE);
+    DIR *dp = per ? opendir(MEMORY_SYSFS) : NULL;
+    if (!dp)
+        return 0;
+    size_t n = 0, cap = 0;
+    struct dirent *de;
+    while ((de = readdir(dp)) != NULL) {
+        unsigned long long id;
+        char tail;
+        if (sscanf(de->d_name, "memory%llu%c", &id, &tail) != 1)
+            continue;
+        char path[320];
+        snprintf(path, sizeof(path), MEMORY_SYSFS "/%s/state", de->d_name);
+        char *st = read_whole(path);
+        int online = st && strncmp(st, "online", 6) == 0;
+        free(st);
+        if (online && pfn_range_add(r, &n, &cap, id * per, (id + 1) * per) != 0)
+            break;
+    }
+    closedir(dp);
+    return n;
+}
+
+/* Present RAM as sorted, merged PFN ranges; *src names the source, NULL if none */
+static size_t ram_ranges(pfn_range_t **r, const char **src) {
+    *r = NULL;
+    *src = IOMEM_PATH;
+    size_t n = ram_ranges_iomem(r);
+    if (n == 0) {
+        *src = MEMORY_SYSFS;
+        n = ram_ranges_sysfs(r);
+    }
+    if (n == 0) {
+        *src = NULL;
+        return 0;
+    }
+    qsort(*r, n, sizeof(**r), pfn_range_cmp);
+    size_t k = 0;
+    for (size_t i = 1; i < n; i++) {
+        if ((*r)[i].start <= (*r)[k].end) {
+            if ((*r)[i].end > (*r)[k].end)
+                (*r)[k].end = (*r)[i].end;
+        } else {
+            (*r)[++k] = (*r)[i];
+        }
+    }
+    return k + 1;
+}
+
+/* Resolve memcg inodes to paths in the memory cgroup hierarchy */
+static cg_tab_t *cg_walk_tab;
+static size_t cg_walk_left;
+static size_t cg_walk_prefix;           /* length of the hierarchy root */
+
+static int cg_walk(const char *path, const struct stat *st, int type, struct FTW *ftw) {
+    (void)ftw;
+    if (type != FTW_D)
+        return 0;
+    cg_tab_t *t = cg_walk_tab;
+    size_t k = ((uint64_t)st->st_ino * 0x9e3779b97f4a7c15ULL >> 32) & (t->cap - 1);
+    while (t->slot[k].ino && t->slot[k].ino != (uint64_t)st->st_ino)
+        k = (k + 1) & (t->cap - 1);
+    if (t->slot[k].ino && !t->slot[k].path[0]) {
+        const char *rel = path + cg_walk_prefix;
+        snprintf(t->slot[k].path, sizeof(t->slot[k].path), "%s", *rel ? rel : "/");
+        if (--cg_walk_left == 0)
+            return 1;
+    }
+    return 0;
+}
+
+static int cg_cmp_pages(const void *a, const void *b) {
+    const cg_count_t *x = a, *y = b;
+    return (x->pages < y->pages) - (x->pages > y->pages);
+}
+
+static void census_free(census_t *c) {
+    free(c->cg.slot);
+    memset(c, 0, sizeof(*c));
+}
+
+/* 0, or -1 with errno when kpageflags cannot be read */
+static int census_collect(census_t *c, double *secs, int *threads) {
+    struct timespec t0, t1;
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+
+    int fd_flags = open(KPAGEFLAGS_PATH, O_RDONLY | O_CLOEXEC);
+    if (fd_flags < 0)
+        return -1;
+    uint64_t probe;
+    if (pread(fd_flags, &probe, sizeof(probe), 0) < 0) {
+        int err = errno;
+        close(fd_flags);
+        errno = err;
+        return -1;
+    }
+    int fd_cg = open(KPAGECGROUP_PATH, O_RDONLY | O_CLOEXEC);
+
+    /* Without a RAM map, fall back to every PFN the zones span */
+    const char *src;
+    pfn_range_t *ram;
+    size_t nram = ram_ranges(&ram, &src);
+    if (nram == 0) {
+        unsigned long long max_pfn = census_max_pfn();
+        if (max_pfn == 0)
+            max_pfn = ~0ULL / sizeof(uint64_t); /* unknown: read to EOF */
+        ram = malloc(sizeof(*ram));
+        if (!ram) {
+            close(fd_flags);
+            if (fd_cg >= 0)
+                close(fd_cg);
+            return -1;
+        }
+        ram[0] = (pfn_range_t){ 0, max_pfn };
+        nram = 1;
+    }
+    unsigned long long present = 0;
+    for (size_t i = 0; i < nram; i++)
+        present += ram[i].end - ram[i].start;
+
+    int nthreads = 1;
+    long ncpu = sysconf(_SC_NPROCESSORS_ONLN);
+    if (src && present >= CENSUS_THREAD_MIN && ncpu > 1)
+        nthreads = ncpu < CENSUS_THREADS ? (int)ncpu : CENSUS_THREADS;
+    unsigned long long share = (present + nthreads - 1) / nthreads;
+    share = (share + CENSUS_GROUP - 1) / CENSUS_GROUP * CENSUS_GROUP;
+
+    /* Deal the ranges out in PFN order, cutting one where a share ends */
+    pthread_t tids[CENSUS_THREADS];
+    census_job_t jobs[CENSUS_THREADS];
+    memset(jobs, 0, sizeof(jobs));
+    size_t ri = 0;
+    unsigned long long at = ram[0].start;
+    for (int i = 0; i < nthreads; i++) {
+        jobs[i].fd_flags = fd_flags;
+        jobs[i].fd_cg = fd_cg;
+        jobs[i].r = malloc(nram * sizeof(*jobs[i].r));
+        unsigned long long left = i == nthreads - 1 ? ~0ULL : share;
+        while (jobs[i].r && ri < nram && left > 0) {
+            unsigned long long end = ram[ri].end - at > left ? at + left : ram[ri].end;
+            jobs[i].r[jobs[i].nr++] = (pfn_range_t){ at, end };
+            left -= end - at;
+            at = end;
+            if (at == ram[ri].end && ++ri < nram)
+                at = ram[ri].start;
+        }
+    }
+    int started = 0;
+    for (int i = 1; i < nthreads; i++) {
+        if (pthread_create(&tids[i], NULL, census_worker, &jobs[i]) == 0)
+            started |= 1 << i;
+    }
+    /* This thread takes range 0, plus any range whose thread failed to start */
+    for (int i = 0; i < nthreads; i++) {
+        if (!(started & (1 << i)))
+            census_worker(&jobs[i]);
+    }
+    for (int i = 1; i < nthreads; i++) {
+        if (started & (1 << i))
+            pthread_join(tids[i], NULL);
+    }
+    close(fd_flags);
+    if (fd_cg >= 0)
+        close(fd_cg);
+
+    memset(c, 0, sizeof(*c));
+    c->have_cg = jobs[0].c.have_cg;
+    for (int i = 0; i < nthreads; i++) {
+        census_t *p = &jobs[i].c;
+        free(jobs[i].r);
+        for (int k = 0; k < CEN_N; k++)
+            c->cls[k] += p->cls[k];
+        c->holes += p->holes;
+        c->thp += p->thp;
+        c->compound += p->compound;
+        c->ksm += p->ksm;
+        c->pfns += p->pfns;
+        for (size_t s = 0; s < p->cg.cap; s++) {
+            if (p->cg.slot[s].ino)
+                cg_add(&c->cg, p->cg.slot[s].ino, p->cg.slot[s].pages, p->cg.slot[s].kernel);
+        }
+        census_free(p);
+    }
+    /* PFNs outside the RAM ranges, up to the last one, are holes too */
+    if (src) {
+        c->holes += ram[nram - 1].end - c->pfns;
+        c->pfns = ram[nram - 1].end;
+        c->ram_src = src;
+        c->nranges = nram;
+    }
+    free(ram);
+
+    if (c->cg.n > 0) {
+        cg_walk_tab = &c->cg;
+        cg_walk_left = c->cg.n;
+        /* v1 hierarchies number inodes separately: only the memory one counts */
+        const char *root = access(CGROUP_V1_MEMORY, F_OK) == 0 ? CGROUP_V1_MEMORY : CGROUP_ROOT;
+        cg_walk_prefix = strlen(root);
+        nftw(root, cg_walk, 16, FTW_PHYS);
+        /* pack and sort; the table is only read as an array from here on */
+        size_t j = 0;
+        for (size_t s = 0; s < c->cg.cap; s++) {
+            if (c->cg.slot[s].ino)
+                c->cg.slot[j++] = c->cg.slot[s];
+        }
+        qsort(c->cg.slot, j, sizeof(c->cg.slot[0]), cg_cmp_pages);
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    *secs = (t1.tv_sec - t0.tv_sec) + (t1.tv_nsec - t0.tv_nsec) / 1e9;
+    *threads = nthreads;
+    return 0;
+}
+
+/* meminfo figure to compare a class with, -1 for none */
+static long census_meminfo_kb(int cls, const meminfo_t *mi) {
+    switch (cls) {
+    case CEN_FREE:    return mi->v[MI_MEM_FREE];
+    case CEN_SLAB:    return mi->v[MI_SLAB];
+    case CEN_PGTABLE: return mi->v[MI_PAGE_TABLES];
+    case CEN_HUGETLB: return mi->v[MI_HUGETLB];
+    case CEN_ANON:    return mi->v[MI_ANON_PAGES];
+    case CEN_SHMEM:   return mi->v[MI_SHMEM];
+    case CEN_FILE:
+        if (mi->v[MI_CACHED] < 0 || mi->v[MI_SHMEM] < 0)
+            return -1;
+        return mi->v[MI_CACHED] + kb_or_zero(mi->v[MI_BUFFERS]) - mi->v[MI_SHMEM];
+    default:          return -1;
+    }
+}
+
+static void print_census(const census_t *c, double secs, int threads, int top,
+                         const meminfo_t *mi) {
+    long kpp = sysconf(_SC_PAGESIZE) / 1024;
+    unsigned long long present = c->pfns - c->holes;
+    printf("\nPage census (%s): %llu PFNs, %llu pages present", KPAGEFLAGS_PATH, c->pfns, present);
+    if (c->ram_src)
+        printf(" in %zu RAM range%s (%s)", c->nranges, c->nranges == 1 ? "" : "s", c->ram_src);
+    printf(", %d thread%s, %.2f s\n", threads, threads == 1 ? "" : "s", secs);
+    printf("  %-18s %12s %12s %6s %12s\n", "Class", "Pages", "kB", "%", "meminfo kB");
+    for (int k = 0; k < CEN_N; k++) {
+        long ref = census_meminfo_kb(k, mi);
+        printf("  %-18s %12llu %12llu %5.1f%%", cen_label[k], c->cls[k], c->cls[k] * kpp,
+               present ? 100.0 * c->cls[k] / present : 0.0);
+        if (ref >= 0)
+            printf(" %12ld", ref);
+        printf("\n");
+    }
+    printf("  Of those: THP %llu, compound %llu, KSM %llu pages\n", c->thp, c->compound, c->ksm);
+
+    if (!c->have_cg)
+        return;
+    size_t shown = (top > 0 && (size_t)top < c->cg.n) ? (size_t)top : c->cg.n;
+    printf("  Top %zu of %zu memory cgroups by charged pages (%s):\n",
+           shown, c->cg.n, KPAGECGROUP_PATH);
+    printf("    %-40s %12s %12s\n", "Cgroup", "kB", "Kernel kB");
+    for (size_t i = 0; i < shown; i++) {
+        const cg_count_t *g = &c->cg.slot[i];
+        if (g->path[0])
+            printf("    %-40s %12llu %12llu\n", g->path, g->pages * kpp, g->kernel * kpp);
+        else
+            printf("    ino %-36llu %12llu %12llu\n", (unsigned long long)g->ino,
+                   g->pages * kpp, g->kernel * kpp);
+    }
+}
+
+static void print_census_json(const census_t *c, double secs, int threads, int top) {
+    long kpp = sysconf(_SC_PAGESIZE) / 1024;
+    static const char *const key[CEN_N] = {
+        "offline", "hwpoison", "reserved", "free", "slab", "pagetables", "hugetlb",
+        "anon", "shmem", "file", "noflags", "other",
+    };
+    printf(",\n  \"census\": {\"pfns\": %llu, \"holes\": %llu, \"present\": %llu, "
+           "\"threads\": %d, \"seconds\": %.3f, \"pages\": {",
+           c->pfns, c->holes, c->pfns - c->holes, threads, secs);
+    for (int k = 0; k < CEN_N; k++)
+        printf("%s\"%s\": %llu", k ? ", " : "", key[k], c->cls[k]);
+    printf("}, \"thp\": %llu, \"compound\": %llu, \"ksm\": %llu, \"page_kb\": %ld",
+           c->thp, c->compound, c->ksm, kpp);
+    if (c->have_cg) {
+        size_t shown = (top > 0 && (size_t)top < c->cg.n) ? (size_t)top : c->cg.n;
+        printf(", \"cgroups\": [");
+        for (size_t i = 0; i < shown; i++) {
+            printf("%s\n    {\"ino\": %llu, \"path\": ", i ? "," : "",
+                   (unsigned long long)c->cg.slot[i].ino);
+            json_put_str(stdout, c->cg.slot[i].path);
+            printf(", \"pages\": %llu, \"kernel_pages\": %llu}",
+                   c->cg.slot[i].pages, c->cg.slot[i].kernel);
+        }
+        printf("\n  ]");
+    }
+    printf("}");
+}
+
+/* ---------- Memory outside /proc/meminfo ---------- */
+
+/*
+ * Kernel memory that no meminfo line covers, for the accounting in the
+ * report: socket buffers (counted in pages by the protocols) and DMA-buf
+ * exports.  Both return kB, or -1 when the source is not there.
+ */
+#define SOCKSTAT_PATH    "/proc/net/sockstat"
+#define SOCKSTAT6_PATH   "/proc/net/sockstat6"
+#define DMABUF_SYSFS     "/sys/kernel/dmabuf/buffers"
+#define DMABUF_DEBUGFS   "/sys/kernel/debug/dma_buf/bufinfo"
+
+/* "TCP: ... mem N" (pages, shared by v4 and v6) plus "FRAG: ... memory N" (bytes) */
+static long sockstat_kb(void) {
+    char *buf = read_whole(SOCKSTAT_PATH);
+    if (!buf)
+        return -1;
+    long long pages = 0, bytes = 0;
+    for (const char *p = strstr(buf, " mem "); p; p = strstr(p + 5, " mem "))
+        pages += strtoll(p + 5, NULL, 10);
+    for (const char *p = strstr(buf, " memory "); p; p = strstr(p + 8, " memory "))
+        bytes += strtoll(p + 8, NULL, 10);
+    free(buf);
+
+    buf = read_whole(SOCKSTAT6_PATH);
+    if (buf) {
+        for (const char *p = strstr(buf, " memory "); p; p = strstr(p + 8, " memory "))
+            bytes += strtoll(p + 8, NULL, 10);
+        free(buf);
+    }
+    return (long)(pages * (sysconf(_SC_PAGESIZE) / 1024) + bytes / 1024);
+}
+
+/* Sum of the exported buffers: sysfs stats if built in, else debugfs */
+static long dmabuf_kb(void) {
+    DIR *d = opendir(DMABUF_SYSFS);
+    if (d) {
+        long long bytes = 0;
+        char path[PATH_MAX], val[32];
+        struct dirent *de;
+        while ((de = readdir(d))) {
+            if (de->d_name[0] == '.')
+                continue;
+            snprintf(path, sizeof(path), "%s/%s/size", DMABUF_SYSFS, de->d_name);
+            int fd = open(path, O_RDONLY | O_CLOEXEC);
+            if (fd < 0)
+                continue;
+            ssize_t n = read(fd, val, sizeof(val) - 1);
+            close(fd);
+            if (n > 0) {
+                val[n] = '\0';
+                bytes += strtoll(val, NULL, 10);
+            }
+        }
+        closedir(d);
+        return (long)(bytes / 1024);
+    }
+
+    char *buf = read_whole(DMABUF_DEBUGFS);
+    if (!buf)
+        return -1;
+    /* last line: "Total N objects, M bytes" */
+    long long bytes = -1;
+    const char *p = strstr(buf, "\nTotal ");
+    if (p && (p = strstr(p, "objects, ")))
+        bytes = strtoll(p + 9, NULL, 10);
+    free(buf);
+    return bytes < 0 ? -1 : (long)(bytes / 1024);
+}
+
+/* ---------- Output ---------- */
+
+static void usage(const char *prog) {
+    fprintf(stderr,
+        "Usage: %s [options]\n"
+        "\n"
+        "Estimate Linux kernel memory usage.\n"
+        "\n"
+        "Options:\n"
+        "  -j, --json              Print the report and the full /proc/meminfo\n"
+        "                          snapshot as JSON\n"
+        "  -s, --slab              Per-cache slab memory, reclaimable or not\n"
+        "  -m, --modules           Per-module core/init size, section split, refs, taint\n"
+        "  -n, --numa              Per-NUMA-node slab, page tables, stacks, vmalloc, percpu\n"
+        "  -v, --vmalloc           vmalloc areas by caller and type (/proc/vmallocinfo)\n"
+        "  -p, --census            Classify every physical page from /proc/kpageflags,\n"
+        "                          per memory cgroup from /proc/kpagecgroup\n"
+        "  -f, --frag              Free blocks per order, zone and migrate type,\n"
+        "                          unusable memory and fragmentation index per order;\n"
+        "                          with --watch, compaction and THP counters\n"
+        "  -a, --alloc-sites       Live bytes by module, file and function from\n"
+        "                          /proc/allocinfo; with --watch, deltas of each\n"
+        "  -t, --top N             Rows shown per breakdown (default: 20)\n"
+        "  -w, --watch SECS        Re-read every SECS: deltas, rates, trends and\n"
+        "                          suspected leaks per category and slab cache\n"
+        "  -c, --count N           With --watch, stop after N samples (default: forever)\n"
+        "      --leak-window N     Samples per trend/leak window (default: 60)\n"
+        "  -h, --help              Show this help\n",
+        prog);
+}
+
+typedef struct {
+    int static_ok;
+    unsigned long long text_kb, data_kb, bss_kb;
+    long slab_kb, sreclaimable_kb, sunreclaim_kb, kreclaimable_kb;
+    long pagetables_kb, secpagetables_kb, vmalloc_kb, kstack_kb, percpu_kb;
+    long zswap_kb, sock_kb, dmabuf_kb;
+    int vmalloc_from_info;          /* VmallocUsed read 0, pages= sum used */
+    int kstack_vmapped;             /* KernelStack taken out of vmalloc_kb */
+    long modules_kb;
+    long static_total_kb, dynamic_total_kb, grand_total_kb;
+
+    /* MemTotal = free + user + dynamic kernel + HugeTLB + unexplained */
+    long mem_total_kb, free_kb;
+    long anon_kb, cache_kb, shmem_kb, buffers_kb, swap_cached_kb, user_kb;
+    long hugetlb_kb, cma_used_kb;
+    long unexplained_kb;
+    int accounting_ok;
+} report_t;
+
+static void report_build(report_t *r, const meminfo_t *mi) {
+    const long *v = mi->v;
+
+    r->static_ok = get_static_sections_kb(&r->text_kb, &r->data_kb, &r->bss_kb);
+    if (r->static_ok == 0)
+        r->static_total_kb = (long)(r->text_kb + r->data_kb + r->bss_kb);
+
+    r->slab_kb          = v[MI_SLAB];
+    r->sreclaimable_kb  = v[MI_SRECLAIMABLE];
+    r->sunreclaim_kb    = v[MI_SUNRECLAIM];
+    /* KReclaimable includes SReclaimable; keep only the non-slab part */
+    r->kreclaimable_kb  = -1;
+    if (v[MI_KRECLAIMABLE] >= 0 && r->sreclaimable_kb >= 0)
+        r->kreclaimable_kb = kb_or_zero(v[MI_KRECLAIMABLE] - r->sreclaimable_kb);
+    r->pagetables_kb    = v[MI_PAGE_TABLES];
+    r->secpagetables_kb = v[MI_SEC_PAGE_TABLES];
+    r->vmalloc_kb       = v[MI_VMALLOC_USED];
+    if (r->vmalloc_kb <= 0) {
+        char *buf = read_whole(VMALLOCINFO_PATH);
+        if (buf) {
+            r->vmalloc_kb = vmallocinfo_pages_kb(buf);
+            r->vmalloc_from_info = 1;
+            free(buf);
+        }
+    }
+    r->kstack_kb        = v[MI_KERNEL_STACK];
+    /* Vmapped stacks are counted by both; keep them under KernelStack only */
+    if (r->vmalloc_kb >= 0 && r->kstack_kb > 0 && kstack_vmapped()) {
+        r->vmalloc_kb = kb_or_zero(r->vmalloc_kb - r->kstack_kb);
+        r->kstack_vmapped = 1;
+    }
+    r->percpu_kb        = v[MI_PERCPU];
+    r->zswap_kb         = v[MI_ZSWAP];
+    r->sock_kb          = sockstat_kb();
+    r->dmabuf_kb        = dmabuf_kb();
+    r->modules_kb       = read_modules_kb();
+
+    const long dyn[] = {
+        r->slab_kb, r->kreclaimable_kb, r->pagetables_kb, r->secpagetables_kb,
+        r->vmalloc_kb, r->kstack_kb, r->percpu_kb, r->zswap_kb, r->sock_kb, r->dmabuf_kb,
+    };
+    for (size_t i = 0; i < sizeof(dyn) / sizeof(dyn[0]); i++)
+        r->dynamic_total_kb += kb_or_zero(dyn[i]);
+
+    /* Module memory is vmalloc'd and already inside vmalloc_kb: not added */
+    r->grand_total_kb = r->static_total_kb + r->dynamic_total_kb;
+
+    /*
+     * What MemTotal is made of.  The kernel image is reserved before
+     * MemTotal is counted and module memory is vmalloc, so neither is
+     * subtracted again.  Shmem is part of Cached.
+     */
+    r->mem_total_kb   = v[MI_MEM_TOTAL];
+    r->free_kb        = v[MI_MEM_FREE];
+    r->anon_kb        = v[MI_ANON_PAGES];
+    r->cache_kb       = v[MI_CACHED];
+    r->shmem_kb       = v[MI_SHMEM];
+    r->buffers_kb     = v[MI_BUFFERS];
+    r->swap_cached_kb = v[MI_SWAP_CACHED];
+    r->user_kb = kb_or_zero(r->anon_kb) + kb_or_zero(r->cache_kb) +
+                 kb_or_zero(r->buffers_kb) + kb_or_zero(r->swap_cached_kb);
+    r->hugetlb_kb = v[MI_HUGETLB];
+    if (r->hugetlb_kb < 0 && v[MI_HUGE_PAGES_TOTAL] >= 0 && v[MI_HUGEPAGESIZE] > 0)
+        r->hugetlb_kb = v[MI_HUGE_PAGES_TOTAL] * v[MI_HUGEPAGESIZE];
+    r->cma_used_kb = -1;
+    if (v[MI_CMA_TOTAL] >= 0 && v[MI_CMA_FREE] >= 0)
+        r->cma_used_kb = v[MI_CMA_TOTAL] - v[MI_CMA_FREE];
+
+    r->accounting_ok = r->mem_total_kb > 0 && r->free_kb >= 0;
+    if (r->accounting_ok)
+        r->unexplained_kb = r->mem_total_kb - r->free_kb - r->user_kb -
+                            r->dynamic_total_kb - kb_or_zero(r->hugetlb_kb);
+}
+
+static void print_report_json(const report_t *r, const meminfo_t *mi) {
+    printf("{\n");
+    if (r->static_ok == 0)
+        printf("  \"static\": {\"text_kb\": %llu, \"data_kb\": %llu, \"bss_kb\": %llu, "
+               "\"total_kb\": %ld},\n", r->text_kb, r->data_kb, r->bss_kb, r->static_total_kb);
+    else
+        printf("  \"static\": null,\n");
+    printf("  \"dynamic\": {");
+    json_kb("slab_kb", r->slab_kb, ", ");
+    json_kb("sreclaimable_kb", r->sreclaimable_kb, ", ");
+    json_kb("sunreclaim_kb", r->sunreclaim_kb, ", ");
+    json_kb("kreclaimable_other_kb", r->kreclaimable_kb, ", ");
+    json_kb("pagetables_kb", r->pagetables_kb, ", ");
+    json_kb("secpagetables_kb", r->secpagetables_kb, ", ");
+    json_kb("vmalloc_used_kb", r->vmalloc_kb, ", ");
+    printf("\"vmalloc_excludes_kernel_stack\": %s, ", r->kstack_vmapped ? "true" : "false");
+    json_kb("kernel_stack_kb", r->kstack_kb, ", ");
+    json_kb("percpu_kb", r->percpu_kb, ", ");
+    json_kb("zswap_kb", r->zswap_kb, ", ");
+    json_kb("sockets_kb", r->sock_kb, ", ");
+    json_kb("dmabuf_kb", r->dmabuf_kb, ", ");
+    json_kb("total_kb", r->dynamic_total_kb, "},\n");
+    printf("  ");
+    json_kb("modules_kb", r->modules_kb, ",\n");
+    printf("  \"total_kb\": %ld,\n", r->grand_total_kb);
+    if (r->accounting_ok) {
+        printf("  \"accounting\": {");
+        json_kb("mem_total_kb", r->mem_total_kb, ", ");
+        json_kb("free_kb", r->free_kb, ", ");
+        json_kb("anon_kb", r->anon_kb, ", ");
+        json_kb("cached_kb", r->cache_kb, ", ");
+        json_kb("shmem_kb", r->shmem_kb, ", ");
+        json_kb("buffers_kb", r->buffers_kb, ", ");
+        json_kb("swap_cached_kb", r->swap_cached_kb, ", ");
+        json_kb("user_kb", r->user_kb, ", ");
+        json_kb("kernel_kb", r->dynamic_total_kb, ", ");
+        json_kb("hugetlb_kb", r->hugetlb_kb, ", ");
+        json_kb("cma_used_kb", r->cma_used_kb, ", ");
+        printf("\"unexplained_kb\": %ld},\n", r->unexplained_kb);
+    } else {
+        printf("  \"accounting\": null,\n");
+    }
+    printf("  \"meminfo\": {");
+    for (size_t i = 0; i < mi->nall; i++)
+        printf("%s\n    \"%s\": %ld", i ? "," : "", mi->all[i].name, mi->all[i].val);
+    printf("\n  }");
+}
+
+/* "  Label:    N kB", skipped when the counter is missing */
+static void print_kb_line(const char *indent, const char *label, long kb) {
+    if (kb >= 0)
+        printf("%s%-*s %10ld kB\n", indent, (int)(22 - strlen(indent)), label, kb);
+}
+
+static void print_report(const report_t *r) {
+    printf("========== Linux Kernel Memory Usage (kernmem) ==========\n\n");
+
+    if (r->static_ok == 0) {
+        printf("Static kernel ELF sections (.text/.data/.bss):\n");
+        printf("  .text:      %10llu kB\n", r->text_kb);
+        printf("  .data:      %10llu kB\n", r->data_kb);
+        printf("  .bss:       %10llu kB\n", r->bss_kb);
+        printf("  Static total: %8ld kB (%.2f MB)\n\n",
+               r->static_total_kb, r->static_total_kb / 1024.0);
+    } else {
+        printf("Static kernel ELF sections: unavailable "
+               "(no usable System.map/kallsyms)\n\n");
+    }
+
+    printf("Dynamic kernel allocations (/proc/meminfo, sockstat, dma-buf):\n");
+    print_kb_line("  ", "Slab:", r->slab_kb);
+    print_kb_line("    ", "SReclaimable:", r->sreclaimable_kb);
+    print_kb_line("    ", "SUnreclaim:", r->sunreclaim_kb);
+    print_kb_line("  ", "KReclaimable other:", r->kreclaimable_kb);
+    print_kb_line("  ", "PageTables:", r->pagetables_kb);
+    print_kb_line("  ", "SecPageTables:", r->secpagetables_kb);
+    print_kb_line("  ", r->vmalloc_from_info ? "Vmalloc pages:" : "VmallocUsed:", r->vmalloc_kb);
+    if (r->kstack_vmapped)
+        printf("    (less KernelStack: stacks are vmalloc'd)\n");
+    print_kb_line("  ", "KernelStack:", r->kstack_kb);
+    print_kb_line("  ", "Percpu:", r->percpu_kb);
+    print_kb_line("  ", "Zswap pool:", r->zswap_kb);
+    print_kb_line("  ", "Sockets:", r->sock_kb);
+    print_kb_line("  ", "DMA-buf:", r->dmabuf_kb);
+    printf("  %-20s %10ld kB (%.2f MB)\n\n", "Dynamic total:",
+           r->dynamic_total_kb, r->dynamic_total_kb / 1024.0);
+
+    printf("Module memory (/proc/modules, part of vmalloc above):\n");
+    if (r->modules_kb >= 0)
+        printf("  Modules:     %10ld kB (%.2f MB)\n\n",
+               r->modules_kb, r->modules_kb / 1024.0);
+    else
+        printf("  Modules:     unavailable (no /proc/modules)\n\n");
+
+    if (r->accounting_ok) {
+        printf("Accounting of MemTotal (%ld kB):\n", r->mem_total_kb);
+        print_kb_line("  ", "Free:", r->free_kb);
+        print_kb_line("  ", "Userspace:", r->user_kb);
+        print_kb_line("    ", "AnonPages:", r->anon_kb);
+        print_kb_line("    ", "Cached:", r->cache_kb);
+        print_kb_line("      ", "Shmem:", r->shmem_kb);
+        print_kb_line("    ", "Buffers:", r->buffers_kb);
+        print_kb_line("    ", "SwapCached:", r->swap_cached_kb);
+        print_kb_line("  ", "Kernel:", r->dynamic_total_kb);
+        print_kb_line("  ", "HugeTLB pool:", r->hugetlb_kb);
+        if (r->cma_used_kb > 0)
+            printf("  (CMA in use: %ld kB, already inside the lines above)\n", r->cma_used_kb);
+        printf("  %-20s %+10ld kB (%.1f%% of MemTotal)\n\n", "Unexplained:",
+               r->unexplained_kb, 100.0 * r->unexplained_kb / r->mem_total_kb);
+    }
+
+    printf("============================================================\n");
+    printf("Estimated TOTAL kernel memory: %ld kB (%.2f MB)\n",
+           r->grand_total_kb, r->grand_total_kb / 1024.0);
+}
+
+/* ---------- Main ---------- */
+
+enum {
+    OPT_LEAK_WINDOW = 256
+};
+
+int main(int argc, char **argv) {
+    int json = 0;
+    int slab = 0;
+    int modules = 0;
+    int numa = 0;
+    int vmalloc = 0;
+    int alloc = 0;
+    int census = 0;
+    int frag = 0;
+    int top = 20;
+    double watch = 0;
+    long count = 0;
+    int window = WATCH_WINDOW;
+
+    static struct option long_opts[] = {
+        {"json", no_argument,       0, 'j'},
+        {"slab", no_argument,       0, 's'},
+        {"modules", no_argument,    0, 'm'},
+        {"numa", no_argument,       0, 'n'},
+        {"vmalloc", no_argument,    0, 'v'},
+        {"alloc-sites", no_argument, 0, 'a'},
+        {"census", no_argument,     0, 'p'},
+        {"frag", no_argument,       0, 'f'},
+        {"top",  required_argument, 0, 't'},
+        {"watch", required_argument, 0, 'w'},
+        {"count", required_argument, 0, 'c'},
+        {"leak-window", required_argument, 0, OPT_LEAK_WINDOW},
+        {"help", no_argument,       0, 'h'},
+        {0, 0, 0, 0}
+    };
+
+    int opt;
+    while ((opt = getopt_long(argc, argv, "jsmnvapft:w:c:h", long_opts, NULL)) != -1) {
+        switch (opt) {
+        case 'j':
+            json = 1;
+            break;
+        case 's':
+            slab = 1;
+            break;
+        case 'm':
+            modules = 1;
+            break;
+        case 'n':
+            numa = 1;
+            break;
+        case 'v':
+            vmalloc = 1;
+            break;
+        case 'a':
+            alloc = 1;
+            break;
+        case 'p':
+            census = 1;
+            break;
+        case 'f':
+            frag = 1;
+            break;
+        case 't':
+            top = atoi(optarg);
+            if (top <= 0) top = 20;
+            break;
+        case 'w':
+            watch = atof(optarg);
+            if (watch <= 0) {
+                fprintf(stderr, "Invalid watch interval: %s\n", optarg);
+                return 1;
+            }
+            break;
+        case 'c':
+            count = atol(optarg);
+            if (count < 0) count = 0;
+            break;
+        case OPT_LEAK_WINDOW:
+            window = atoi(optarg);
+            if (window < 3) {
+                fprintf(stderr, "--leak-window needs at least 3 samples\n");
+                return 1;
+            }
+            break;
+        case 'h':
+        default:
+            usage(argv[0]);
+            return (opt == 'h') ? 0 : 1;
+        }
+    }
+
+    if (watch > 0) {
+        if (json) {
+            fprintf(stderr, "--json applies to a single snapshot, not --watch\n");
+            return 1;
+        }
+        return run_watch(watch, count, window, top, alloc, frag);
+    }
+
+    meminfo_t mi = {0};
+    if (meminfo_snapshot(&mi) != 0) {
+        fprintf(stderr, "Cannot read %s\n", MEMINFO_PATH);
+        return 1;
+    }
+
+    report_t r = {0};
+    report_build(&r, &mi);
+
+    slab_list_t sl = {0};
+    if (slab && slab_collect(&sl) != 0) {
+        fprintf(stderr, "Cannot read %s or %s\n", SLABINFO_PATH, SLAB_SYSFS);
+        slab = 0;
+    }
+
+    kmod_list_t ml = {0};
+    if (modules && kmod_collect(&ml) != 0) {
+        fprintf(stderr, "Cannot read %s\n", MODULE_SYSFS);
+        modules = 0;
+    }
+
+    numa_node_t nodes[NUMA_MAX_NODES];
+    int nnodes = 0;
+    if (numa && numa_collect(nodes, &nnodes, mi.v[MI_PERCPU]) != 0) {
+        fprintf(stderr, "Cannot read %s\n", NODE_SYSFS);
+        numa = 0;
+    }
+
+    vm_agg_t va = {0};
+    if (vmalloc) {
+        if (vm_collect(&va) != 0) {
+            fprintf(stderr, "Cannot read %s\n", VMALLOCINFO_PATH);
+            vmalloc = 0;
+        } else {
+            agg_sort(&va.callers);
+        }
+    }
+
+    alloc_agg_t aa = {0};
+    int have_alloc = 0;
+    if (alloc) {
+        have_alloc = alloc_collect(&aa) == 0;
+        if (!have_alloc)
+            alloc_unavailable(errno);
+    }
+
+    census_t cen = {0};
+    double cen_secs = 0;
+    int cen_threads = 0;
+    if (census && census_collect(&cen, &cen_secs, &cen_threads) != 0) {
+        fprintf(stderr, "Cannot read %s: %s\n", KPAGEFLAGS_PATH, strerror(errno));
+        census = 0;
+    }
+
+    frag_t *fr = NULL;
+    if (frag) {
+        fr = calloc(1, sizeof(*fr));
+        if (!fr || frag_collect(fr) != 0) {
+            fprintf(stderr, "Cannot read %s\n", BUDDYINFO_PATH);
+            frag = 0;
+        }
+    }
+
+    if (json) {
+        print_report_json(&r, &mi);
+        if (slab)
+            print_slab_json(&sl, top);
+        if (modules)
+            print_modules_json(&ml, top);
+        if (numa)
+            print_numa_json(nodes, nnodes);
+        if (vmalloc)
+            print_vmalloc_json(&va, top);
+        if (alloc)
+            print_alloc_json(have_alloc ? &aa : NULL, top);
+        if (census)
+            print_census_json(&cen, cen_secs, cen_threads, top);
+        if (frag)
+            print_frag_json(fr);
+        printf("\n}\n");
+    } else {
+        print_report(&r);
+        if (slab)
+            print_slab(&sl, top, &mi);
+        if (modules)
+            print_modules(&ml, top);
+        if (numa)
+            print_numa(nodes, nnodes);
+        if (vmalloc)
+            print_vmalloc(&va, top, &mi);
+        if (have_alloc)
+            print_alloc(&aa, top);
+        if (census)
+            print_census(&cen, cen_secs, cen_threads, top, &mi);
+        if (frag)
+            print_frag(fr, &mi);
+    }
 
+    free(fr);
+    census_free(&cen);
+    alloc_free(&aa);
+    agg_free(&va.callers);
+    free(ml.m);
+    slab_free(&sl);
+    meminfo_free(&mi);
     return 0;
 }
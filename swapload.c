@@ -0,0 +1,482 @@
+/*
+ * swapload.c
+ *
+ * Synthetic workload for tuning swapout: allocate a known amount of memory,
+ * keep a configurable hot fraction of it busy and report how long touches
+ * take once pages start coming back from swap.
+ *
+ * Memory layout:
+ *   - anonymous private memory (optionally MADV_HUGEPAGE for THP)
+ *   - optionally a memfd-backed shared region (shmem), --shmem FRACTION
+ *
+ * The first hot-fraction of every region is touched in a loop using the
+ * chosen access pattern; the rest stays cold after the initial fill.  Each
+ * page touch is timed; touches slower than --slow-us are counted as faults
+ * and their latencies reported as percentiles.
+ *
+ * Usage:
+ *   swapload [options]
+ *
+ * Options:
+ *   -s, --size GB           Total memory to allocate (default: 1)
+ *   -H, --hot FRACTION      Fraction kept hot, 0..1 (default: 0.10)
+ *   -p, --pattern PATTERN   seq, random or stride (default: seq)
+ *   -t, --thp               MADV_HUGEPAGE on the anonymous region
+ *   -S, --shmem FRACTION    Fraction placed in a memfd shared region (default: 0)
+ *   -z, --compressible F    Fraction of each page that compresses (default: 0.5)
+ *   -i, --interval MS       Pause between hot passes (default: 100)
+ *   -r, --report SECS       Print a report line every SECS (default: 5)
+ *   -w, --slow-us US        Touch latency counted as a fault (default: 20)
+ *   -R, --ready-file PATH   Create PATH once memory is populated
+ *   -h, --help              Show this help
+ *
+ * Signals:
+ *   SIGUSR1  touch every page once (re-warm everything)
+ *   SIGUSR2  print a report line now
+ *   SIGINT/SIGTERM  print a final report and exit
+ *
+ * Build:
+ *   gcc -O2 -Wall -Wextra -std=c11 -o swapload swapload.c
+ *
+ * Author: Jerry Richardson <jerry@jerryslab.com>
+ * Copyright (C) 2025
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <signal.h>
+#include <getopt.h>
+#include <fcntl.h>
+#include <time.h>
+#include <stdint.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+
+typedef enum {
+    PATTERN_SEQ = 0,
+    PATTERN_RANDOM,
+    PATTERN_STRIDE
+} pattern_t;
+
+typedef struct {
+    char  *base;
+    size_t len;
+    size_t hot_len;
+    const char *name;
+} region_t;
+
+/* Touch latency histogram: bucket i holds latencies in [2^i, 2^(i+1)) ns */
+#define LAT_BUCKETS 40
+
+typedef struct {
+    unsigned long long touches;
+    unsigned long long slow;
+    unsigned long long hist[LAT_BUCKETS];
+    unsigned long long max_ns;
+} lat_stats_t;
+
+static volatile sig_atomic_t g_stop;
+static volatile sig_atomic_t g_rewarm;
+static volatile sig_atomic_t g_report;
+
+static long g_page;
+
+/* ------------ Utility helpers ------------ */
+
+static void usage(const char *prog) {
+    fprintf(stderr,
+        "Usage: %s [options]\n"
+        "\n"
+        "Allocate memory with a hot/cold split and report page touch latency,\n"
+        "as a reproducible target for swapout.\n"
+        "\n"
+        "Options:\n"
+        "  -s, --size GB           Total memory to allocate (default: 1)\n"
+        "  -H, --hot FRACTION      Fraction kept hot, 0..1 (default: 0.10)\n"
+        "  -p, --pattern PATTERN   seq, random or stride (default: seq)\n"
+        "  -t, --thp               MADV_HUGEPAGE on the anonymous region\n"
+        "  -S, --shmem FRACTION    Fraction placed in a memfd shared region (default: 0)\n"
+        "  -z, --compressible F    Fraction of each page that compresses (default: 0.5)\n"
+        "  -i, --interval MS       Pause between hot passes (default: 100)\n"
+        "  -r, --report SECS       Print a report line every SECS (default: 5)\n"
+        "  -w, --slow-us US        Touch latency counted as a fault (default: 20)\n"
+        "  -R, --ready-file PATH   Create PATH once memory is populated\n"
+        "  -h, --help              Show this help\n"
+        "\n"
+        "Signals: USR1 re-warms every page, USR2 prints a report, INT/TERM exit.\n"
+        "\n"
+        "Example:\n"
+        "  %s -s 4 -H 0.2 -p random -t -R /run/swapload.ready &\n",
+        prog, prog
+    );
+}
+
+static double now_secs(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+static unsigned long long now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (unsigned long long)ts.tv_sec * 1000000000ULL + (unsigned long long)ts.tv_nsec;
+}
+
+static void sleep_ms(long ms) {
+    if (ms <= 0) return;
+    struct timespec ts = { ms / 1000, (ms % 1000) * 1000000L };
+    nanosleep(&ts, NULL);
+}
+
+static void on_signal(int sig) {
+    if (sig == SIGUSR1)
+        g_rewarm = 1;
+    else if (sig == SIGUSR2)
+        g_report = 1;
+    else
+        g_stop = 1;
+}
+
+/* xorshift64: cheap, reproducible page order for the random pattern */
+static uint64_t rng_next(uint64_t *s) {
+    uint64_t x = *s;
+    x ^= x << 13;
+    x ^= x >> 7;
+    x ^= x << 17;
+    *s = x;
+    return x;
+}
+
+/*
+ * Fill one page: the leading part with PRNG output, the rest with a
+ * repeated byte, so zswap/zram see roughly 1/(1 - compressible) worth of
+ * compression.  The page index goes first so no two pages are identical.
+ */
+static void fill_page(char *p, size_t idx, size_t random_bytes, uint64_t *s) {
+    size_t page = (size_t)g_page;
+    size_t i = 0;
+    for (; i < random_bytes; i += sizeof(uint64_t)) {
+        uint64_t v = rng_next(s);
+        memcpy(p + i, &v, sizeof(v));
+    }
+    memset(p + i, (int)(idx | 1) & 0xff, page - i);
+    uint64_t tag = (uint64_t)idx;
+    memcpy(p, &tag, sizeof(tag));
+}
+
+/* ------------ Allocation ------------ */
+
+static int alloc_anon(region_t *r, size_t len, int thp) {
+    r->name = "anon";
+    r->len = len;
+    r->base = mmap(NULL, len, PROT_READ | PROT_WRITE,
+                   MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (r->base == MAP_FAILED)
+        return -1;
+    madvise(r->base, len, thp ? MADV_HUGEPAGE : MADV_NOHUGEPAGE);
+    return 0;
+}
+
+static int alloc_shmem(region_t *r, size_t len) {
+    r->name = "shmem";
+    r->len = len;
+    int fd = (int)syscall(SYS_memfd_create, "swapload", 0);
+    if (fd < 0)
+        return -1;
+    if (ftruncate(fd, (off_t)len) != 0) {
+        close(fd);
+        return -1;
+    }
+    r->base = mmap(NULL, len, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    return (r->base == MAP_FAILED) ? -1 : 0;
+}
+
+/* ------------ Touching ------------ */
+
+static void lat_record(lat_stats_t *st, unsigned long long ns, unsigned long long slow_ns) {
+    st->touches++;
+    if (ns < slow_ns)
+        return;
+    st->slow++;
+    int b = 0;
+    while (b < LAT_BUCKETS - 1 && (ns >> (b + 1)) != 0)
+        b++;
+    st->hist[b]++;
+    if (ns > st->max_ns)
+        st->max_ns = ns;
+}
+
+/* Upper bound (ns) of the bucket containing the pct-th slow touch */
+static unsigned long long lat_pct(const lat_stats_t *st, double pct) {
+    if (st->slow == 0)
+        return 0;
+    unsigned long long want = (unsigned long long)(pct / 100.0 * (double)st->slow);
+    if (want == 0) want = 1;
+    unsigned long long seen = 0;
+    for (int b = 0; b < LAT_BUCKETS; b++) {
+        seen += st->hist[b];
+        if (seen >= want)
+            return (2ULL << b) < st->max_ns ? (2ULL << b) : st->max_ns;
+    }
+    return st->max_ns;
+}
+
+static void touch_page(char *p, lat_stats_t *st, unsigned long long slow_ns) {
+    unsigned long long t0 = now_ns();
+    (*(volatile char *)p)++;
+    lat_record(st, now_ns() - t0, slow_ns);
+}
+
+/* One pass over the first n bytes of a region in the chosen order */
+static void touch_pass(region_t *r, size_t n, pattern_t pat, uint64_t *seed,
+                       lat_stats_t *st, unsigned long long slow_ns) {
+    size_t pages = n / (size_t)g_page;
+    if (pages == 0)
+        return;
+
+    switch (pat) {
+    case PATTERN_SEQ:
+        for (size_t i = 0; i < pages && !g_stop; i++)
+            touch_page(r->base + i * (size_t)g_page, st, slow_ns);
+        break;
+    case PATTERN_RANDOM:
+        for (size_t i = 0; i < pages && !g_stop; i++)
+            touch_page(r->base + (rng_next(seed) % pages) * (size_t)g_page, st, slow_ns);
+        break;
+    case PATTERN_STRIDE: {
+        /* 64 interleaved sweeps: defeats readahead but stays deterministic */
+        size_t stride = 64;
+        for (size_t s = 0; s < stride && !g_stop; s++)
+            for (size_t i = s; i < pages && !g_stop; i += stride)
+                touch_page(r->base + i * (size_t)g_page, st, slow_ns);
+        break;
+    }
+    }
+}
+
+/* ------------ Reporting ------------ */
+
+static long read_status_kb(const char *key) {
+    FILE *fp = fopen("/proc/self/status", "r");
+    if (!fp) return -1;
+    char line[256];
+    long val = -1;
+    size_t klen = strlen(key);
+    while (fgets(line, sizeof(line), fp)) {
+        if (strncmp(line, key, klen) == 0) {
+            val = strtol(line + klen, NULL, 10);
+            break;
+        }
+    }
+    fclose(fp);
+    return val;
+}
+
+static void report(const char *tag, double t_start, unsigned long passes,
+                   const lat_stats_t *st) {
+    struct rusage ru;
+    getrusage(RUSAGE_SELF, &ru);
+
+    printf("[swapload] %s t=%.1fs passes=%lu touches=%llu slow=%llu "
+           "majflt=%ld rss=%ld kB swap=%ld kB "
+           "slow_p50=%.1fus slow_p99=%.1fus slow_max=%.1fus\n",
+           tag, now_secs() - t_start, passes, st->touches, st->slow,
+           ru.ru_majflt, read_status_kb("VmRSS:"), read_status_kb("VmSwap:"),
+           lat_pct(st, 50) / 1000.0, lat_pct(st, 99) / 1000.0,
+           st->max_ns / 1000.0);
+    fflush(stdout);
+}
+
+/* ------------ CLI / main ------------ */
+
+int main(int argc, char **argv) {
+    double size_gb = 1.0;
+    double hot = 0.10;
+    double shmem = 0.0;
+    double compressible = 0.5;
+    pattern_t pattern = PATTERN_SEQ;
+    int thp = 0;
+    long interval_ms = 100;
+    double report_secs = 5.0;
+    long slow_us = 20;
+    const char *ready_file = NULL;
+
+    static struct option long_opts[] = {
+        {"size",       required_argument, 0, 's'},
+        {"hot",        required_argument, 0, 'H'},
+        {"pattern",    required_argument, 0, 'p'},
+        {"thp",        no_argument,       0, 't'},
+        {"shmem",      required_argument, 0, 'S'},
+        {"compressible", required_argument, 0, 'z'},
+        {"interval",   required_argument, 0, 'i'},
+        {"report",     required_argument, 0, 'r'},
+        {"slow-us",    required_argument, 0, 'w'},
+        {"ready-file", required_argument, 0, 'R'},
+        {"help",       no_argument,       0, 'h'},
+        {0,0,0,0}
+    };
+
+    int opt;
+    while ((opt = getopt_long(argc, argv, "s:H:p:tS:z:i:r:w:R:h", long_opts, NULL)) != -1) {
+        switch (opt) {
+        case 's':
+            size_gb = atof(optarg);
+            if (size_gb <= 0) size_gb = 1.0;
+            break;
+        case 'H':
+            hot = atof(optarg);
+            if (hot < 0) hot = 0;
+            if (hot > 1) hot = 1;
+            break;
+        case 'p':
+            if (strcmp(optarg, "seq") == 0) {
+                pattern = PATTERN_SEQ;
+            } else if (strcmp(optarg, "random") == 0) {
+                pattern = PATTERN_RANDOM;
+            } else if (strcmp(optarg, "stride") == 0) {
+                pattern = PATTERN_STRIDE;
+            } else {
+                fprintf(stderr, "Unknown pattern '%s' (use seq, random or stride)\n", optarg);
+                return 1;
+            }
+            break;
+        case 't':
+            thp = 1;
+            break;
+        case 'S':
+            shmem = atof(optarg);
+            if (shmem < 0) shmem = 0;
+            if (shmem > 1) shmem = 1;
+            break;
+        case 'z':
+            compressible = atof(optarg);
+            if (compressible < 0) compressible = 0;
+            if (compressible > 1) compressible = 1;
+            break;
+        case 'i':
+            interval_ms = atol(optarg);
+            if (interval_ms < 0) interval_ms = 0;
+            break;
+        case 'r':
+            report_secs = atof(optarg);
+            if (report_secs <= 0) report_secs = 5.0;
+            break;
+        case 'w':
+            slow_us = atol(optarg);
+            if (slow_us <= 0) slow_us = 20;
+            break;
+        case 'R':
+            ready_file = optarg;
+            break;
+        case 'h':
+        default:
+            usage(argv[0]);
+            return (opt == 'h') ? 0 : 1;
+        }
+    }
+
+    g_page = sysconf(_SC_PAGESIZE);
+    size_t total = (size_t)(size_gb * 1024.0 * 1024.0 * 1024.0);
+    total -= total % (size_t)g_page;
+    size_t shmem_len = (size_t)((double)total * shmem);
+    shmem_len -= shmem_len % (size_t)g_page;
+    size_t anon_len = total - shmem_len;
+
+    region_t regions[2];
+    int nregions = 0;
+
+    if (anon_len > 0) {
+        if (alloc_anon(&regions[nregions], anon_len, thp) != 0) {
+            fprintf(stderr, "mmap anon %zu bytes: %s\n", anon_len, strerror(errno));
+            return 1;
+        }
+        nregions++;
+    }
+    if (shmem_len > 0) {
+        if (alloc_shmem(&regions[nregions], shmem_len) != 0) {
+            fprintf(stderr, "memfd %zu bytes: %s\n", shmem_len, strerror(errno));
+            return 1;
+        }
+        nregions++;
+    }
+
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = on_signal;
+    sigaction(SIGINT, &sa, NULL);
+    sigaction(SIGTERM, &sa, NULL);
+    sigaction(SIGUSR1, &sa, NULL);
+    sigaction(SIGUSR2, &sa, NULL);
+
+    /*
+     * Populate every byte, so neither same-filled page detection nor KSM
+     * can shortcut swap-out and the compressor sees realistic input.
+     */
+    size_t random_bytes = (size_t)((double)g_page * (1.0 - compressible));
+    random_bytes -= random_bytes % sizeof(uint64_t);
+    uint64_t fill_seed = 0x2545f4914f6cdd1dULL;
+    double t_start = now_secs();
+    for (int i = 0; i < nregions; i++) {
+        region_t *r = &regions[i];
+        r->hot_len = (size_t)((double)r->len * hot);
+        r->hot_len -= r->hot_len % (size_t)g_page;
+        for (size_t off = 0; off < r->len; off += (size_t)g_page)
+            fill_page(r->base + off, off / (size_t)g_page, random_bytes, &fill_seed);
+    }
+
+    printf("[swapload] pid=%d size=%.2f GB (anon %zu MB%s, shmem %zu MB) hot=%.0f%% "
+           "compressible=%.0f%% pattern=%s populated in %.2fs\n",
+           getpid(), size_gb, anon_len >> 20, thp ? " THP" : "", shmem_len >> 20,
+           hot * 100.0, compressible * 100.0,
+           pattern == PATTERN_SEQ ? "seq" : pattern == PATTERN_RANDOM ? "random" : "stride",
+           now_secs() - t_start);
+    fflush(stdout);
+
+    if (ready_file) {
+        FILE *fp = fopen(ready_file, "w");
+        if (fp) {
+            fprintf(fp, "%d\n", getpid());
+            fclose(fp);
+        }
+    }
+
+    lat_stats_t st;
+    memset(&st, 0, sizeof(st));
+    unsigned long long slow_ns = (unsigned long long)slow_us * 1000ULL;
+    uint64_t seed = 0x9e3779b97f4a7c15ULL;
+    unsigned long passes = 0;
+    double t_run = now_secs();
+    double next_report = t_run + report_secs;
+
+    while (!g_stop) {
+        if (g_rewarm) {
+            g_rewarm = 0;
+            for (int i = 0; i < nregions; i++)
+                touch_pass(&regions[i], regions[i].len, PATTERN_SEQ, &seed, &st, slow_ns);
+            report("rewarm", t_run, passes, &st);
+        }
+
+        for (int i = 0; i < nregions; i++)
+            touch_pass(&regions[i], regions[i].hot_len, pattern, &seed, &st, slow_ns);
+        passes++;
+
+        if (g_report || now_secs() >= next_report) {
+            g_report = 0;
+            report("stats", t_run, passes, &st);
+            next_report = now_secs() + report_secs;
+        }
+        sleep_ms(interval_ms);
+    }
+
+    report("final", t_run, passes, &st);
+    if (ready_file)
+        unlink(ready_file);
+    return 0;
+}
@@ -0,0 +1,197 @@
+#!/bin/bash
+#
+# swapout-bench.sh
+#
+# End-to-end benchmark for swapout: start a swapload workload, push it out
+# with each swapout strategy in turn and tabulate how long it took, how
+# much swap I/O it caused and how many pages were refaulted afterwards.
+#
+# Usage:
+#   swapout-bench.sh [strategy...]      (default: clamp reclaim madvise cold)
+#
+# Environment:
+#   BENCH_SIZE_GB   Workload size in GB (default: 1)
+#   BENCH_HOT       Hot fraction kept busy by swapload (default: 0.10)
+#   BENCH_PATTERN   swapload access pattern (default: random)
+#   BENCH_SETTLE    Seconds to keep the workload running afterwards (default: 10)
+#   BENCH_ARGS      Extra swapload arguments (e.g. "--thp --shmem 0.2")
+#   SWAPOUT         swapout binary (default: ./swapout)
+#   SWAPLOAD        swapload binary (default: ./swapload)
+#
+# Requires root and active swap (a swap file is fine).
+#
+# Author: Jerry Richardson (jerry@jerryslab.com)
+# (C) Copyright 2025
+#
+
+SIZE_GB="${BENCH_SIZE_GB:-1}"
+HOT="${BENCH_HOT:-0.10}"
+PATTERN="${BENCH_PATTERN:-random}"
+SETTLE="${BENCH_SETTLE:-10}"
+SWAPOUT="${SWAPOUT:-./swapout}"
+SWAPLOAD="${SWAPLOAD:-./swapload}"
+STRATEGIES=("$@")
+[[ ${#STRATEGIES[@]} -eq 0 ]] && STRATEGIES=(clamp reclaim madvise cold)
+
+WORKDIR="$(mktemp -d /tmp/swapout-bench.XXXXXX)"
+LOAD_PID=""
+BENCH_CG=""
+
+# --- Helpers ---
+vmstat_val() {
+    awk -v k="$1" '$1 == k { print $2; exit }' /proc/vmstat
+}
+
+status_kb() {
+    awk -v k="$2:" '$1 == k { print $2; exit }' "/proc/$1/status" 2>/dev/null
+}
+
+now() {
+    date +%s.%N
+}
+
+cleanup() {
+    [[ -n "$LOAD_PID" ]] && kill "$LOAD_PID" 2>/dev/null && wait "$LOAD_PID" 2>/dev/null
+    LOAD_PID=""
+    if [[ -n "$BENCH_CG" && -d "$BENCH_CG" ]]; then
+        rmdir "$BENCH_CG" 2>/dev/null
+    fi
+    BENCH_CG=""
+}
+trap 'cleanup; rm -rf "$WORKDIR"' EXIT
+trap 'exit 130' INT TERM
+
+# Create a dedicated memory cgroup for --cgroup based strategies
+make_bench_cgroup() {
+    if [[ -f /sys/fs/cgroup/cgroup.controllers ]]; then
+        BENCH_CG=/sys/fs/cgroup/swapout-bench
+    elif [[ -d /sys/fs/cgroup/memory ]]; then
+        BENCH_CG=/sys/fs/cgroup/memory/swapout-bench
+    else
+        return 1
+    fi
+    mkdir -p "$BENCH_CG" 2>/dev/null || return 1
+}
+
+# Start swapload (optionally inside $1 cgroup) and wait until populated
+start_load() {
+    local cg="$1" ready="$WORKDIR/ready"
+    rm -f "$ready"
+    if [[ -n "$cg" ]]; then
+        # Join the group before allocating so every charge lands there
+        sh -c 'echo $$ > "$1/cgroup.procs" && shift && exec "$@"' sh "$cg" \
+            "$SWAPLOAD" -s "$SIZE_GB" -H "$HOT" -p "$PATTERN" -r 3600 -R "$ready" \
+            $BENCH_ARGS > "$WORKDIR/load.log" 2>&1 &
+    else
+        "$SWAPLOAD" -s "$SIZE_GB" -H "$HOT" -p "$PATTERN" -r 3600 -R "$ready" \
+            $BENCH_ARGS > "$WORKDIR/load.log" 2>&1 &
+    fi
+    LOAD_PID=$!
+    while [[ ! -f "$ready" ]]; do
+        if ! kill -0 "$LOAD_PID" 2>/dev/null; then
+            echo "ERROR: swapload exited during setup:" >&2
+            cat "$WORKDIR/load.log" >&2
+            return 1
+        fi
+        sleep 0.2
+    done
+    # Let the hot loop settle so the hot set is actually hot
+    sleep 2
+}
+
+# --- Preconditions ---
+if [[ $EUID -ne 0 ]]; then
+    echo "ERROR: swapout-bench must run as root."
+    exit 1
+fi
+if [[ ! -x "$SWAPOUT" || ! -x "$SWAPLOAD" ]]; then
+    echo "ERROR: $SWAPOUT and $SWAPLOAD must be built first (make swapout swapload)."
+    exit 1
+fi
+if [[ "$(awk 'NR > 1' /proc/swaps | wc -l)" -eq 0 ]]; then
+    echo "ERROR: no active swap. A swap file is enough, e.g.:"
+    echo "  fallocate -l 4G /swapfile && chmod 600 /swapfile && mkswap /swapfile && swapon /swapfile"
+    exit 1
+fi
+
+PAGE_KB=$(( $(getconf PAGESIZE) / 1024 ))
+HOT_KB=$(awk -v s="$SIZE_GB" -v h="$HOT" 'BEGIN { printf "%d", s * 1048576 * h }')
+# Stop once RSS is down to the hot set plus 10% and 16 MB of slack
+TARGET_KB=$(( HOT_KB + HOT_KB / 10 + 16384 ))
+LIMIT_MB=$(( TARGET_KB / 1024 ))
+
+echo "swapout-bench: ${SIZE_GB} GB, hot ${HOT}, pattern ${PATTERN}, target ${TARGET_KB} kB, settle ${SETTLE}s"
+echo
+
+declare -a ROWS
+
+for strat in "${STRATEGIES[@]}"; do
+    cg=""
+    case "$strat" in
+        clamp)   args=(-M clamp -m "$LIMIT_MB" -r "$TARGET_KB" -i 0.5 -n 60) ;;
+        madvise) args=(-M madvise) ;;
+        cold)    args=(-M cold) ;;
+        reclaim)
+            if [[ ! -f /sys/fs/cgroup/cgroup.controllers ]]; then
+                ROWS+=("$(printf '%-8s %s' "$strat" 'n/a (memory.reclaim needs cgroup v2)')")
+                continue
+            fi
+            make_bench_cgroup || { ROWS+=("$(printf '%-8s %s' "$strat" 'n/a (cannot create cgroup)')"); continue; }
+            cg="$BENCH_CG"
+            args=(-M reclaim -r "$TARGET_KB" -i 0.5 -n 60)
+            ;;
+        *)
+            echo "Unknown strategy '$strat' (use clamp, reclaim, madvise or cold)"
+            exit 1
+            ;;
+    esac
+
+    echo "[+] $strat: starting swapload"
+    start_load "$cg" || exit 1
+    rss_before=$(status_kb "$LOAD_PID" VmRSS)
+
+    out0=$(vmstat_val pswpout); in0=$(vmstat_val pswpin)
+    ref0=$(vmstat_val workingset_refault_anon)
+    t0=$(now)
+    if [[ -n "$cg" ]]; then
+        "$SWAPOUT" --cgroup "$cg" "${args[@]}" -q > "$WORKDIR/$strat.log" 2>&1
+    else
+        "$SWAPOUT" "$LOAD_PID" "${args[@]}" -q > "$WORKDIR/$strat.log" 2>&1
+    fi
+    rc=$?
+    t1=$(now)
+    out1=$(vmstat_val pswpout); in1=$(vmstat_val pswpin)
+    rss_after=$(status_kb "$LOAD_PID" VmRSS)
+
+    # Keep the workload running so refaults of the hot set show up
+    sleep "$SETTLE"
+    ref1=$(vmstat_val workingset_refault_anon)
+    in2=$(vmstat_val pswpin)
+    swap_end=$(status_kb "$LOAD_PID" VmSwap)
+
+    kill -USR2 "$LOAD_PID" 2>/dev/null
+    sleep 0.5
+    lat=$(grep '^\[swapload\] stats' "$WORKDIR/load.log" | tail -n 1 | grep -o 'slow_p99=[^ ]*')
+    cleanup
+
+    [[ $rc -ne 0 ]] && echo "[!] $strat: swapout exited with status $rc (see below)" && cat "$WORKDIR/$strat.log"
+
+    ROWS+=("$(awk -v s="$strat" -v t0="$t0" -v t1="$t1" \
+        -v rb="$rss_before" -v ra="$rss_after" \
+        -v o="$(( (out1 - out0) * PAGE_KB ))" -v i="$(( (in1 - in0) * PAGE_KB ))" \
+        -v i2="$(( (in2 - in1) * PAGE_KB ))" -v r="$(( ${ref1:-0} - ${ref0:-0} ))" \
+        -v sw="${swap_end:-0}" -v lat="${lat#slow_p99=}" \
+        'BEGIN { printf "%-8s %8.2f %9d %9d %9d %9d %9d %9d %9d %10s",
+                 s, t1 - t0, rb / 1024, ra / 1024, o / 1024, i / 1024, i2 / 1024, r, sw / 1024, lat }')")
+done
+
+echo
+printf '%-8s %8s %9s %9s %9s %9s %9s %9s %9s %10s\n' \
+    strategy time_s rss0_MB rss1_MB out_MB in_MB settle_MB refaults swap_MB p99_slow
+for row in "${ROWS[@]}"; do
+    echo "$row"
+done
+echo
+echo "time_s: swapout wall time to reach its target; out/in_MB: pswpout/pswpin during the run;"
+echo "settle_MB: swap-in over the ${SETTLE}s afterwards; refaults: workingset_refault_anon from start to end of settle;"
+echo "p99_slow: 99th percentile of slow (faulting) touches seen by swapload."
@@ -6,14 +6,50 @@
  *
  * Requires root (or sufficient privileges to manage cgroups and move PIDs).
  *
+ * Targets are placed into reusable worker groups from a pool kept under
+ * one parent cgroup (swapout/worker-NNN).  Workers are locked with flock()
+ * on /run/swapout/pool/worker-NNN.lock while in use, the target is moved
+ * back to its original cgroup afterwards, and workers idle for longer than
+ * --pool-idle seconds are garbage-collected.
+ *
+ * Each cgroup mutation is journaled to /run/swapout/<pid>.json before it
+ * is made; a fatal signal or "swapout --recover" replays the journal.
+ *
  * Usage:
- *   swapout PID [options]
+ *   swapout PID [PID...] [options]
+ *   swapout --cgroup PATH | --unit NAME [options]
+ *   swapout --tmpfs DIR
+ *   swapout --gc
+ *   swapout --recover
  *
  * Options:
  *   -m, --limit-mb MB       Memory limit during swapout (default: 8 MB)
  *   -r, --target-rss-kb KB  Target RSS to reach before stopping (default: 16384 kB)
  *   -i, --interval SECS     Poll interval in seconds (default: 1.0)
  *   -n, --max-iter N        Maximum iterations before giving up (default: 60)
+ *   -M, --method METHOD     clamp (cgroup limit, default), madvise, cold or reclaim
+ *       --cgroup PATH       Reclaim an existing cgroup in place (no PID)
+ *       --unit NAME         Same, for the cgroup of a systemd unit
+ *       --tmpfs DIR         Page out the files of a tmpfs mount (no PID)
+ *       --cold              Same as --method cold
+ *       --tier TIER         zswap (compressed RAM only) or disk (bypass zswap)
+ *       --thp MODE          THP-backed VMAs: split, cold or skip
+ *       --node N            Only pages resident on NUMA node N (madvise/cold)
+ *       --manifest FILE     Record swapped ranges; with --swapin, replay them
+ *       --swapin            Bring the target's swapped memory back in
+ *       --park              Freeze, page out and record a manifest; stay frozen
+ *       --unpark            Prefetch the --park manifest, then thaw and move back
+ *       --wait-port P[,P]   With --unpark, wait for a connection on a listed port
+ *       --order ORDER       Prefetch order: swap, addr or hot
+ *       --sample-access S   Sample access bits before pageout (for --order hot)
+ *   -j, --jobs N            Threads for --swapin (default: 4) and madvise pageout (default: 1)
+ *       --impact SECS       Sample target latency/faults/PSI during and after
+ *       --impact-interval S Sample period for --impact (default: 0.25)
+ *       --probe CMD         With --impact, time CMD every period
+ *   -P, --parallel N        Targets processed concurrently in batch mode (default: 4)
+ *       --pool-idle SECS    Remove pool workers idle longer than this (default: 600)
+ *       --gc                Garbage-collect idle pool workers and exit
+ *       --recover           Undo cgroup changes journaled by killed swapout runs
  *   -q, --quiet             Less verbose output
  *   -h, --help              Show this help
  *
@@ -32,7 +68,21 @@
 #include <dirent.h>
 #include <getopt.h>
 #include <sys/stat.h>
+#include <sys/file.h>
+#include <sys/wait.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <sys/mman.h>
+#include <sys/vfs.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <ftw.h>
+#include <limits.h>
 #include <time.h>
+#include <stdint.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <signal.h>
 
 typedef enum {
     CGROUP_NONE = 0,
@@ -44,13 +94,75 @@ typedef struct {
     pid_t pid;
     long rss_kb;
     long swap_kb;
+    long shmem_kb;          /* RssShmem: */
 } proc_meminfo_t;
 
+typedef enum {
+    METHOD_CLAMP = 0,       /* temporary cgroup memory limit */
+    METHOD_MADVISE,         /* process_madvise(MADV_PAGEOUT) on anon VMAs */
+    METHOD_COLD,            /* process_madvise(MADV_COLD): deactivate, no I/O */
+    METHOD_RECLAIM          /* memory.reclaim on an existing cgroup (--cgroup/--unit) */
+} pageout_method_t;
+
+typedef enum {
+    THP_DEFAULT = 0,        /* no special handling */
+    THP_SPLIT,              /* page THP-backed VMAs out explicitly (kernel splits) */
+    THP_COLD,               /* only MADV_COLD THP-backed VMAs */
+    THP_SKIP                /* leave THP-backed VMAs alone */
+} thp_mode_t;
+
+typedef enum {
+    TIER_DEFAULT = 0,       /* leave the worker's zswap settings alone */
+    TIER_ZSWAP,             /* compressed RAM only: zswap on, no writeback */
+    TIER_DISK               /* bypass zswap, straight to the swap device */
+} swap_tier_t;
+
+typedef enum {
+    ORDER_SWAP = 0,                  /* swap slot order: sequential reads, reclaim order */
+    ORDER_ADDR,                      /* ascending virtual address */
+    ORDER_HOT                        /* most referenced first (needs --sample-access) */
+} manifest_order_t;
+
+typedef struct {
+    pageout_method_t method;
+    thp_mode_t thp;
+    swap_tier_t tier;
+    long   limit_mb;        /* memory limit during swapout */
+    long   target_rss_kb;   /* stop when RSS <= this */
+    double interval;        /* seconds between polls */
+    int    max_iter;        /* maximum iterations */
+    int    quiet;
+    int    swapin;          /* prefetch instead of paging out */
+    const char *manifest;   /* record / replay swapped ranges */
+    int    batch;           /* several targets: suffix manifest with .PID */
+    manifest_order_t order; /* swapin prefetch order */
+    double sample_secs;     /* access-bit sampling window before pageout */
+    int    jobs;            /* prefetch / pageout threads, 0 = default */
+    int    impact;          /* sample target latency/faults/PSI */
+    double impact_window;   /* keep sampling this long after pageout */
+    double impact_interval; /* sample period */
+    const char *probe_cmd;  /* timed periodically during sampling */
+    int    node;            /* only pages resident on this NUMA node, -1 = all */
+    int    park;            /* freeze + page out + manifest, leave frozen */
+    int    unpark;          /* prefetch manifest, thaw, move back */
+    int    wait_ports[16];  /* --unpark: wait for a connection on one of these */
+    int    nwait_ports;
+} swapout_opts_t;
+
+#define POOL_RUN_DIR      "/run/swapout"
+#define POOL_LOCK_DIR     POOL_RUN_DIR "/pool"
+#define POOL_MAX_WORKERS  256
+#define POOL_IDLE_SECS    600
+
 /* ---------- utility helpers ---------- */
 
 static void usage(const char *prog) {
     fprintf(stderr,
-        "Usage: %s PID [options]\n"
+        "Usage: %s PID [PID...] [options]\n"
+        "       %s --cgroup PATH | --unit NAME [options]\n"
+        "       %s --tmpfs DIR\n"
+        "       %s --gc\n"
+        "       %s --recover\n"
         "\n"
         "Force a process's memory to be pushed into swap by constraining it to a\n"
         "small cgroup memory limit, then restoring the limit afterwards.\n"
@@ -60,12 +172,55 @@ static void usage(const char *prog) {
         "  -r, --target-rss-kb KB  Target RSS to reach before stopping (default: 16384 kB)\n"
         "  -i, --interval SECS     Poll interval in seconds (default: 1.0)\n"
         "  -n, --max-iter N        Maximum iterations before giving up (default: 60)\n"
+        "  -M, --method METHOD     clamp (cgroup limit, default), madvise\n"
+        "                          (process_madvise MADV_PAGEOUT on anon VMAs),\n"
+        "                          cold (MADV_COLD only, no I/O) or reclaim\n"
+        "                          (memory.reclaim, with --cgroup/--unit)\n"
+        "      --cgroup PATH       Reclaim an existing cgroup in place (no PID);\n"
+        "                          -r is then the target usage of the group\n"
+        "      --unit NAME         Same, for the cgroup of a systemd unit\n"
+        "      --tmpfs DIR         Page out the files of a tmpfs mount (no PID)\n"
+        "      --cold              Same as --method cold\n"
+        "      --tier TIER         zswap (compressed RAM only) or disk (bypass\n"
+        "                          zswap); clamp method, cgroup v2\n"
+        "      --thp MODE          THP-backed VMAs: split (page out, kernel splits),\n"
+        "                          cold (MADV_COLD only) or skip (madvise method)\n"
+        "      --node N            Only page out memory resident on NUMA node N\n"
+        "                          (madvise or cold method)\n"
+        "      --manifest FILE     After pageout, record the swapped ranges in FILE;\n"
+        "                          with --swapin, prefetch exactly those ranges\n"
+        "      --swapin            Bring the target's swapped memory back in\n"
+        "      --park              Freeze the target, page it out and record --manifest;\n"
+        "                          it stays frozen until --unpark\n"
+        "      --unpark            Prefetch the --park manifest, then thaw and move back\n"
+        "      --wait-port P[,P]   With --unpark, first wait for a connection to one\n"
+        "                          of these local TCP ports\n"
+        "      --order ORDER       Prefetch order: swap (slot order, default), addr,\n"
+        "                          or hot (most referenced first)\n"
+        "      --sample-access S   Sample access bits for S seconds before pageout\n"
+        "                          so the manifest can be replayed hottest first\n"
+        "  -j, --jobs N            Threads for --swapin (default: 4) and madvise\n"
+        "                          pageout, split into balanced shards (default: 1)\n"
+        "      --impact SECS       Sample the target's run delay, major faults and\n"
+        "                          memory PSI during pageout and SECS afterwards\n"
+        "      --impact-interval S Sample period for --impact (default: 0.25)\n"
+        "      --probe CMD         With --impact, time CMD (sh -c) every period\n"
+        "  -P, --parallel N        Targets processed concurrently in batch mode (default: 4)\n"
+        "      --pool-idle SECS    Remove pool workers idle longer than this (default: 600)\n"
+        "      --gc                Garbage-collect idle pool workers and exit\n"
+        "      --recover           Undo the cgroup changes journaled in /run/swapout\n"
+        "                          by swapout runs that were killed, and exit\n"
         "  -q, --quiet             Less verbose output\n"
         "  -h, --help              Show this help\n"
         "\n"
         "Example:\n"
-        "  %s 12345 -m 8 -r 16384 -i 1 -n 60\n",
-        prog, prog
+        "  %s 12345 -m 8 -r 16384 -i 1 -n 60\n"
+        "  %s 1201 1202 1203 -P 8\n"
+        "  %s 12345 --manifest /var/tmp/app.swm --sample-access 5\n"
+        "  %s 12345 --swapin --manifest /var/tmp/app.swm --order hot -j 8\n"
+        "  %s --unit foo.service -M reclaim -r 65536\n"
+        "  %s --tmpfs /dev/shm\n",
+        prog, prog, prog, prog, prog, prog, prog, prog, prog, prog, prog
     );
 }
 
@@ -74,34 +229,49 @@ static int file_exists(const char *path) {
     return stat(path, &st) == 0;
 }
 
-/* Read whole file into buffer (small text files only) */
-static char *read_file(const char *path) {
-    FILE *fp = fopen(path, "r");
-    if (!fp) return NULL;
-    if (fseek(fp, 0, SEEK_END) != 0) {
-        fclose(fp);
-        return NULL;
-    }
-    long len = ftell(fp);
-    if (len < 0) {
-        fclose(fp);
-        return NULL;
-    }
-    if (fseek(fp, 0, SEEK_SET) != 0) {
-        fclose(fp);
+/*
+ * Read whole file into buffer (small text files only).  Reads until EOF
+ * rather than trusting st_size: procfs/cgroupfs files report 0 or 4096.
+ */
+static char *read_file_at(int dirfd, const char *path) {
+    int fd = openat(dirfd, path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return NULL;
+    FILE *fp = fdopen(fd, "r");
+    if (!fp) {
+        close(fd);
         return NULL;
     }
-    char *buf = malloc((size_t)len + 1);
+
+    size_t cap = 4096;
+    size_t len = 0;
+    char *buf = malloc(cap);
     if (!buf) {
         fclose(fp);
         return NULL;
     }
-    size_t n = fread(buf, 1, (size_t)len, fp);
+    size_t n;
+    while ((n = fread(buf + len, 1, cap - len - 1, fp)) > 0) {
+        len += n;
+        if (cap - len - 1 == 0) {
+            char *nb = realloc(buf, cap * 2);
+            if (!nb) {
+                free(buf);
+                fclose(fp);
+                return NULL;
+            }
+            buf = nb;
+            cap *= 2;
+        }
+    }
     fclose(fp);
-    buf[n] = '\0';
+    buf[len] = '\0';
     return buf;
 }
 
+static char *read_file(const char *path) {
+    return read_file_at(AT_FDCWD, path);
+}
+
 /* Write a string to a file (overwrite) */
 static int write_file(const char *path, const char *val) {
     FILE *fp = fopen(path, "w");
@@ -121,6 +291,13 @@ static void rtrim(char *s) {
     }
 }
 
+/* Monotonic clock in seconds */
+static double now_secs(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
 /* Sleep in seconds (double) */
 static void sleep_double(double secs) {
     if (secs <= 0) return;
@@ -131,17 +308,95 @@ static void sleep_double(double secs) {
     nanosleep(&ts, NULL);
 }
 
-/* ---------- proc mem info ---------- */
+/* ---------- target handle ---------- */
+
+#ifndef SYS_pidfd_send_signal
+#define SYS_pidfd_send_signal 424
+#endif
+#ifndef SYS_pidfd_open
+#define SYS_pidfd_open 434
+#endif
+
+/*
+ * The target process is pinned by a pidfd for the whole run.  All /proc
+ * reads go through procfd, a directory fd opened while the pidfd proved the
+ * process alive, so they can never land on a recycled PID.  Exit is seen
+ * by poll()ing the pidfd.
+ */
+typedef struct {
+    pid_t pid;
+    int   pidfd;
+    int   procfd;              /* /proc/<pid> */
+} target_t;
+
+static int pidfd_open(pid_t pid) {
+    return (int)syscall(SYS_pidfd_open, pid, 0);
+}
+
+static int target_open(pid_t pid, target_t *t) {
+    t->pid = pid;
+    t->procfd = -1;
+    t->pidfd = pidfd_open(pid);
+    if (t->pidfd < 0)
+        return -1;
 
-static int read_proc_meminfo(pid_t pid, proc_meminfo_t *out) {
     char path[64];
-    snprintf(path, sizeof(path), "/proc/%d/status", pid);
-    FILE *fp = fopen(path, "r");
+    snprintf(path, sizeof(path), "/proc/%d", pid);
+    t->procfd = open(path, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+
+    /* Still alive after the open: the directory belongs to our process */
+    if (t->procfd < 0 ||
+        syscall(SYS_pidfd_send_signal, t->pidfd, 0, NULL, 0) != 0) {
+        int saved = errno;
+        if (t->procfd >= 0) close(t->procfd);
+        close(t->pidfd);
+        t->pidfd = t->procfd = -1;
+        errno = saved;
+        return -1;
+    }
+    return 0;
+}
+
+static void target_close(target_t *t) {
+    if (t->procfd >= 0) close(t->procfd);
+    if (t->pidfd >= 0) close(t->pidfd);
+    t->pidfd = t->procfd = -1;
+}
+
+/* Wait up to secs for the target to exit; 1 if it has, 0 on timeout */
+static int target_wait_exit(const target_t *t, double secs) {
+    struct pollfd pfd = { .fd = t->pidfd, .events = POLLIN };
+    int ms = secs > 0 ? (int)(secs * 1000.0) : 0;
+    int r;
+    do {
+        r = poll(&pfd, 1, ms);
+    } while (r < 0 && errno == EINTR);
+    return r > 0;
+}
+
+static int target_exited(const target_t *t) {
+    return target_wait_exit(t, 0);
+}
+
+static FILE *target_fopen(const target_t *t, const char *name, const char *mode) {
+    int flags = (mode[0] == 'w') ? O_WRONLY : O_RDONLY;
+    int fd = openat(t->procfd, name, flags | O_CLOEXEC);
+    if (fd < 0) return NULL;
+    FILE *fp = fdopen(fd, mode);
+    if (!fp) close(fd);
+    return fp;
+}
+
+/* ---------- proc mem info ---------- */
+
+static int read_proc_meminfo(const target_t *t, proc_meminfo_t *out) {
+    FILE *fp = target_fopen(t, "status", "r");
     if (!fp) return -1;
 
     char line[256];
     long rss_kb = 0;
     long swap_kb = 0;
+    long shmem_kb = 0;
 
     while (fgets(line, sizeof(line), fp)) {
         if (strncmp(line, "VmRSS:", 6) == 0) {
@@ -153,219 +408,3507 @@ static int read_proc_meminfo(pid_t pid, proc_meminfo_t *out) {
             char *p = line;
             while (*p && !isdigit((unsigned char)*p)) p++;
             if (*p) swap_kb = strtol(p, NULL, 10);
+        } else if (strncmp(line, "RssShmem:", 9) == 0) {
+            shmem_kb = strtol(line + 9, NULL, 10);
         }
     }
     fclose(fp);
 
-    out->pid = pid;
+    out->pid = t->pid;
     out->rss_kb = rss_kb;
     out->swap_kb = swap_kb;
+    out->shmem_kb = shmem_kb;
     return 0;
 }
 
-/* ---------- cgroup detection & setup ---------- */
-
-static cgroup_version_t detect_cgroup_version(void) {
-    /* v2 unified if /sys/fs/cgroup/cgroup.controllers exists */
-    if (file_exists("/sys/fs/cgroup/cgroup.controllers")) {
-        return CGROUP_V2;
-    }
-    /* v1 memory controller */
-    if (file_exists("/sys/fs/cgroup/memory")) {
-        return CGROUP_V1;
+/* Read one field of /proc/meminfo in kB, -1 if missing */
+static long read_sys_meminfo_kb(const char *key) {
+    FILE *fp = fopen("/proc/meminfo", "r");
+    if (!fp) return -1;
+    char line[256];
+    long val = -1;
+    size_t klen = strlen(key);
+    while (fgets(line, sizeof(line), fp)) {
+        if (strncmp(line, key, klen) == 0 && line[klen] == ':') {
+            val = strtol(line + klen + 1, NULL, 10);
+            break;
+        }
     }
-    return CGROUP_NONE;
+    fclose(fp);
+    return val;
 }
 
-/* Creates parent swapout directory if needed */
-static int ensure_dir(const char *path) {
-    struct stat st;
-    if (stat(path, &st) == 0) {
-        if (S_ISDIR(st.st_mode))
-            return 0;
-        errno = ENOTDIR;
-        return -1;
-    }
-    if (mkdir(path, 0755) != 0) {
-        return -1;
+/* Read one counter from /proc/vmstat, -1 if missing */
+static long long read_vmstat(const char *key) {
+    FILE *fp = fopen("/proc/vmstat", "r");
+    if (!fp) return -1;
+
+    char name[64];
+    long long val;
+    long long found = -1;
+    while (fscanf(fp, "%63s %lld", name, &val) == 2) {
+        if (strcmp(name, key) == 0) {
+            found = val;
+            break;
+        }
     }
-    return 0;
+    fclose(fp);
+    return found;
 }
 
-/* Setup cgroup paths for a given pid */
+/* ---------- VMA scanning (smaps) ---------- */
+
 typedef struct {
-    cgroup_version_t ver;
-    char group_dir[256];       /* /sys/fs/cgroup/.../swapout/<pid> */
-    char procs_path[512];      /* .../cgroup.procs */
-    char limit_path[512];      /* memory.high or memory.limit_in_bytes */
-    char backup_limit[128];    /* original limit text */
-    int  had_backup;
-} cgroup_ctx_t;
+    unsigned long start;
+    unsigned long end;
+    char perms[8];
+    long rss_kb;
+    long anon_kb;              /* Anonymous: */
+    long thp_kb;               /* AnonHugePages: */
+    long swap_kb;
+    long ref_kb;               /* Referenced: */
+    char name[128];            /* pathname or [heap]/[stack]/... */
+} vma_t;
 
-static int setup_cgroup_for_pid(pid_t pid, cgroup_ctx_t *ctx, int quiet) {
-    memset(ctx, 0, sizeof(*ctx));
-    ctx->ver = detect_cgroup_version();
-    if (ctx->ver == CGROUP_NONE) {
-        fprintf(stderr, "No cgroup v1/v2 memory controller detected under /sys/fs/cgroup\n");
+typedef struct {
+    vma_t *v;
+    size_t n;
+} vma_list_t;
+
+static void free_vmas(vma_list_t *l) {
+    free(l->v);
+    l->v = NULL;
+    l->n = 0;
+}
+
+static long smaps_kb(const char *line, const char *key) {
+    size_t klen = strlen(key);
+    if (strncmp(line, key, klen) != 0)
         return -1;
+    return strtol(line + klen, NULL, 10);
+}
+
+/* Parse /proc/<pid>/smaps into a list of VMAs with their memory counters */
+static int read_vmas(const target_t *t, vma_list_t *out) {
+    FILE *fp = target_fopen(t, "smaps", "r");
+    if (!fp) return -1;
+
+    out->v = NULL;
+    out->n = 0;
+    size_t cap = 0;
+    vma_t *cur = NULL;
+    char line[512];
+
+    while (fgets(line, sizeof(line), fp)) {
+        unsigned long start, end;
+        char perms[8];
+        int name_off = 0;
+
+        if (sscanf(line, "%lx-%lx %7s %*x %*x:%*x %*u %n",
+                   &start, &end, perms, &name_off) >= 3 && name_off > 0) {
+            if (out->n == cap) {
+                size_t ncap = cap ? cap * 2 : 256;
+                vma_t *nv = realloc(out->v, ncap * sizeof(vma_t));
+                if (!nv) {
+                    fclose(fp);
+                    free_vmas(out);
+                    return -1;
+                }
+                out->v = nv;
+                cap = ncap;
+            }
+            cur = &out->v[out->n++];
+            memset(cur, 0, sizeof(*cur));
+            cur->start = start;
+            cur->end = end;
+            snprintf(cur->perms, sizeof(cur->perms), "%s", perms);
+            snprintf(cur->name, sizeof(cur->name), "%s", line + name_off);
+            rtrim(cur->name);
+            continue;
+        }
+        if (!cur)
+            continue;
+
+        long v;
+        if ((v = smaps_kb(line, "Rss:")) >= 0)                cur->rss_kb = v;
+        else if ((v = smaps_kb(line, "Anonymous:")) >= 0)     cur->anon_kb = v;
+        else if ((v = smaps_kb(line, "AnonHugePages:")) >= 0) cur->thp_kb = v;
+        else if ((v = smaps_kb(line, "Swap:")) >= 0)          cur->swap_kb = v;
+        else if ((v = smaps_kb(line, "Referenced:")) >= 0)    cur->ref_kb = v;
     }
+    fclose(fp);
+    return 0;
+}
 
-    char pid_str[32];
-    snprintf(pid_str, sizeof(pid_str), "%d", pid);
+static int vma_is_thp(const vma_t *v) {
+    return v->thp_kb > 0;
+}
 
-    if (ctx->ver == CGROUP_V2) {
-        const char *base = "/sys/fs/cgroup/swapout";
-        if (ensure_dir("/sys/fs/cgroup") != 0 && errno != EEXIST) {
-            perror("mkdir /sys/fs/cgroup");
-            return -1;
+/*
+ * Shared mappings of shmem: SysV segments, memfds, POSIX shm in /dev/shm
+ * and MAP_SHARED|MAP_ANONYMOUS (shown as /dev/zero or [anon_shmem:...]).
+ * Their pages are not "Anonymous:" in smaps, so the anon paths miss them.
+ */
+static int vma_is_shmem(const vma_t *v) {
+    if (v->perms[3] != 's')
+        return 0;
+    return strncmp(v->name, "/SYSV", 5) == 0 ||
+           strncmp(v->name, "/memfd:", 7) == 0 ||
+           strncmp(v->name, "/dev/shm/", 9) == 0 ||
+           strncmp(v->name, "/dev/zero", 9) == 0 ||
+           strncmp(v->name, "[anon_shmem", 11) == 0;
+}
+
+/* Resident memory the madvise paths can act on: private anon or shmem */
+static long vma_pageable_kb(const vma_t *v) {
+    if (v->anon_kb > 0)
+        return v->anon_kb;
+    return vma_is_shmem(v) ? v->rss_kb : 0;
+}
+
+static void report_shmem(const vma_list_t *l, const char *when) {
+    int n = 0;
+    long rss = 0, swap = 0;
+    for (size_t i = 0; i < l->n; i++) {
+        if (vma_is_shmem(&l->v[i])) {
+            n++;
+            rss += l->v[i].rss_kb;
+            swap += l->v[i].swap_kb;
         }
-        if (ensure_dir(base) != 0 && errno != EEXIST) {
-            perror("mkdir /sys/fs/cgroup/swapout");
-            return -1;
+    }
+    if (n)
+        printf("[+] Shmem %s: %d VMA(s), resident=%ld kB, swapped=%ld kB\n", when, n, rss, swap);
+}
+
+/* Sum AnonHugePages over all VMAs; *nvmas gets the number of THP-backed VMAs */
+static long thp_total_kb(const vma_list_t *l, int *nvmas) {
+    long total = 0;
+    int n = 0;
+    for (size_t i = 0; i < l->n; i++) {
+        if (vma_is_thp(&l->v[i])) {
+            total += l->v[i].thp_kb;
+            n++;
         }
-        snprintf(ctx->group_dir, sizeof(ctx->group_dir), "%s/%s", base, pid_str);
-        if (ensure_dir(ctx->group_dir) != 0 && errno != EEXIST) {
-            perror("mkdir group_dir");
-            return -1;
+    }
+    if (nvmas) *nvmas = n;
+    return total;
+}
+
+static void report_thp(const vma_list_t *l, const char *when, int verbose) {
+    int n = 0;
+    long total = thp_total_kb(l, &n);
+    printf("[+] THP %s: %d VMA(s), AnonHugePages=%ld kB\n", when, n, total);
+    if (!verbose)
+        return;
+    for (size_t i = 0; i < l->n; i++) {
+        const vma_t *v = &l->v[i];
+        if (!vma_is_thp(v))
+            continue;
+        printf("     %012lx-%012lx %-4s THP=%ld kB RSS=%ld kB %s\n",
+               v->start, v->end, v->perms, v->thp_kb, v->rss_kb, v->name);
+    }
+}
+
+/* ---------- process_madvise ---------- */
+
+#ifndef SYS_process_madvise
+#define SYS_process_madvise 440
+#endif
+#ifndef MADV_COLD
+#define MADV_COLD 20
+#endif
+#ifndef MADV_PAGEOUT
+#define MADV_PAGEOUT 21
+#endif
+
+/*
+ * Kernel limits per process_madvise() call: UIO_MAXIOV iovecs and a total
+ * length of MAX_RW_COUNT (just under 2 GB).  Ranges are cut into 1 GB
+ * chunks and batches kept under that total so every call completes.
+ */
+#define MADV_IOV_BATCH  1024
+#define MADV_CHUNK      (1UL << 30)
+
+typedef struct {
+    struct iovec *iov;
+    size_t n;
+    size_t cap;
+} iov_list_t;
+
+static void free_iovs(iov_list_t *l) {
+    free(l->iov);
+    l->iov = NULL;
+    l->n = l->cap = 0;
+}
+
+/* Append [start, end) split into MADV_CHUNK pieces */
+static int iov_add(iov_list_t *l, unsigned long start, unsigned long end) {
+    while (start < end) {
+        unsigned long len = end - start;
+        if (len > MADV_CHUNK) len = MADV_CHUNK;
+        if (l->n == l->cap) {
+            size_t ncap = l->cap ? l->cap * 2 : 256;
+            struct iovec *ni = realloc(l->iov, ncap * sizeof(*ni));
+            if (!ni) return -1;
+            l->iov = ni;
+            l->cap = ncap;
         }
-        snprintf(ctx->procs_path, sizeof(ctx->procs_path), "%s/cgroup.procs", ctx->group_dir);
-        snprintf(ctx->limit_path, sizeof(ctx->limit_path), "%s/memory.high", ctx->group_dir);
+        l->iov[l->n].iov_base = (void *)start;
+        l->iov[l->n].iov_len = len;
+        l->n++;
+        start += len;
+    }
+    return 0;
+}
 
-        if (!quiet)
-            printf("[+] cgroup v2 detected, using %s\n", ctx->group_dir);
-    } else {
-        /* v1 memory controller */
-        const char *base = "/sys/fs/cgroup/memory/swapout";
-        if (ensure_dir("/sys/fs/cgroup/memory") != 0 && errno != EEXIST) {
-            perror("mkdir /sys/fs/cgroup/memory");
-            return -1;
+static const char *advice_name(int advice) {
+    switch (advice) {
+    case MADV_COLD:    return "MADV_COLD";
+    case MADV_PAGEOUT: return "MADV_PAGEOUT";
+    case MADV_WILLNEED: return "MADV_WILLNEED";
+    default:           return "advice";
+    }
+}
+
+/* Errors that no later range will get past: unsupported, not allowed, target gone */
+static int advise_fatal(int err) {
+    return err == ENOSYS || err == EPERM || err == ESRCH;
+}
+
+/*
+ * Apply advice to every range in iov via process_madvise(), in batches of
+ * MADV_IOV_BATCH.  A range the kernel refuses (locked, PFN-mapped, ...) is
+ * skipped and the rest of the batch retried.  Returns bytes advised, or -1
+ * with errno set on an error that applies to every range.
+ */
+static long long advise_ranges(int pidfd, const struct iovec *iov, size_t n,
+                               int advice, int quiet) {
+    long long done = 0;
+    size_t i = 0;
+
+    while (i < n) {
+        size_t batch = 0;
+        unsigned long bytes = 0;
+        while (i + batch < n && batch < MADV_IOV_BATCH &&
+               bytes + iov[i + batch].iov_len <= 2 * MADV_CHUNK - 4096) {
+            bytes += iov[i + batch].iov_len;
+            batch++;
         }
-        if (ensure_dir(base) != 0 && errno != EEXIST) {
-            perror("mkdir /sys/fs/cgroup/memory/swapout");
-            return -1;
+
+        long ret = (long)syscall(SYS_process_madvise, pidfd, &iov[i], batch, advice, 0);
+        if (ret < 0 && errno == EINTR)
+            continue;
+
+        /* ret counts the bytes of whole iovecs completed before any failure */
+        if (ret > 0) {
+            long left = ret;
+            while (i < n && left >= (long)iov[i].iov_len) {
+                left -= (long)iov[i].iov_len;
+                i++;
+            }
+            done += ret;
+            continue;
         }
-        snprintf(ctx->group_dir, sizeof(ctx->group_dir), "%s/%s", base, pid_str);
-        if (ensure_dir(ctx->group_dir) != 0 && errno != EEXIST) {
-            perror("mkdir group_dir");
+
+        if (ret < 0 && advise_fatal(errno)) {
+            int err = errno;
+            fprintf(stderr, "[!] process_madvise(%s): %s\n", advice_name(advice), strerror(err));
+            errno = err;
             return -1;
         }
-        snprintf(ctx->procs_path, sizeof(ctx->procs_path), "%s/cgroup.procs", ctx->group_dir);
-        snprintf(ctx->limit_path, sizeof(ctx->limit_path), "%s/memory.limit_in_bytes", ctx->group_dir);
 
+        /* iov[i] was refused outright: report it and move past */
         if (!quiet)
-            printf("[+] cgroup v1 (memory) detected, using %s\n", ctx->group_dir);
+            fprintf(stderr, "[!] %s %#lx+%zu: %s\n", advice_name(advice),
+                    (unsigned long)iov[i].iov_base, iov[i].iov_len,
+                    ret < 0 ? strerror(errno) : "no progress");
+        i++;
     }
+    return done;
+}
 
-    /* Backup original limit, if readable */
-    char *orig = read_file(ctx->limit_path);
-    if (orig) {
-        rtrim(orig);
-        strncpy(ctx->backup_limit, orig, sizeof(ctx->backup_limit) - 1);
-        ctx->backup_limit[sizeof(ctx->backup_limit) - 1] = '\0';
-        free(orig);
-        ctx->had_backup = 1;
-        if (!quiet)
-            printf("[+] Original limit at %s: '%s'\n", ctx->limit_path, ctx->backup_limit);
-    } else {
-        ctx->had_backup = 0;
-        if (!quiet)
-            printf("[!] Could not read original limit at %s, will not restore.\n", ctx->limit_path);
-    }
+/* ---------- swap manifests ---------- */
 
-    /* Move PID into this cgroup */
-    char pidbuf[32];
-    snprintf(pidbuf, sizeof(pidbuf), "%d\n", pid);
-    if (write_file(ctx->procs_path, pidbuf) != 0) {
-        fprintf(stderr, "Failed to move pid %d into %s: %s\n",
-                pid, ctx->procs_path, strerror(errno));
-        return -1;
+/*
+ * A manifest records which virtual ranges of a process were in swap right
+ * after a pageout, as address runs, so a later --swapin can prefetch just
+ * those ranges instead of rescanning the whole address space.
+ *
+ * File layout: manifest_hdr_t, then (version 2, MANIFEST_PARKED) a
+ * manifest_park_t, then hdr.nruns manifest_run_t records, all in host byte
+ * order.  Version 1 files are still read.
+ */
+#define MANIFEST_MAGIC    "SWPMANI1"
+#define MANIFEST_VERSION  2
+#define MANIFEST_HEAT     0x1u       /* runs carry sampled access heat */
+#define MANIFEST_PARKED   0x2u       /* written by --park: a manifest_park_t follows */
+
+typedef struct {
+    char     magic[8];
+    uint32_t version;
+    uint32_t flags;
+    int32_t  pid;
+    uint32_t page_size;
+    uint64_t start_time;             /* /proc/<pid>/stat starttime, detects PID reuse */
+    uint64_t nruns;
+    uint64_t npages;
+} manifest_hdr_t;
+
+typedef struct {
+    uint64_t start;                  /* first virtual address of the run */
+    uint32_t npages;
+    uint16_t heat;                   /* referenced per mille of the owning VMA */
+    uint16_t reserved;
+    uint64_t swap_off;               /* swap slot of the first page */
+} manifest_run_t;
+
+/* Where a parked process came from, so --unpark can put it back */
+typedef struct {
+    char origin[256];                /* memory (v1) or unified (v2) cgroup path */
+    char origin_freezer[256];        /* v1 freezer cgroup path, empty on v2 */
+} manifest_park_t;
+
+typedef struct {
+    manifest_hdr_t hdr;
+    manifest_park_t park;            /* valid if hdr.flags & MANIFEST_PARKED */
+    manifest_run_t *runs;
+} manifest_t;
+
+/* pagemap entry bits, see Documentation/admin-guide/mm/pagemap.rst */
+#define PM_PRESENT        (1ULL << 63)
+#define PM_SWAP           (1ULL << 62)
+#define PM_SWAP_OFFSET(e) (((e) & ((1ULL << 55) - 1)) >> 5)
+
+#define PAGEMAP_BATCH     65536      /* entries per pread(): 512 kB */
+
+/* Field 22 of /proc/<pid>/stat: start time in clock ticks since boot */
+static unsigned long long read_start_time(const target_t *t) {
+    char *buf = read_file_at(t->procfd, "stat");
+    if (!buf) return 0;
+
+    unsigned long long start = 0;
+    char *p = strrchr(buf, ')');   /* comm may contain spaces */
+    if (p) {
+        /* state is field 3; skip to field 22 */
+        int field = 2;
+        for (p++; *p && field < 22; p++) {
+            if (*p == ' ')
+                field++;
+        }
+        start = strtoull(p, NULL, 10);
     }
-    if (!quiet)
-        printf("[+] Moved PID %d into %s\n", pid, ctx->group_dir);
+    free(buf);
+    return start;
+}
 
+static int manifest_add_run(manifest_t *m, size_t *cap, uint64_t start,
+                            uint64_t swap_off, uint16_t heat) {
+    if (m->hdr.nruns == *cap) {
+        size_t ncap = *cap ? *cap * 2 : 1024;
+        manifest_run_t *nr = realloc(m->runs, ncap * sizeof(*nr));
+        if (!nr) return -1;
+        m->runs = nr;
+        *cap = ncap;
+    }
+    manifest_run_t *r = &m->runs[m->hdr.nruns++];
+    memset(r, 0, sizeof(*r));
+    r->start = start;
+    r->npages = 1;
+    r->heat = heat;
+    r->swap_off = swap_off;
     return 0;
 }
 
-/* Apply low memory limit */
-static int apply_low_limit(const cgroup_ctx_t *ctx, long limit_mb, int quiet) {
-    char buf[64];
-    if (ctx->ver == CGROUP_V2) {
-        /* memory.high uses "max" or byte value */
-        long long bytes = (long long)limit_mb * 1024LL * 1024LL;
-        snprintf(buf, sizeof(buf), "%lld\n", bytes);
-    } else {
-        long long bytes = (long long)limit_mb * 1024LL * 1024LL;
-        snprintf(buf, sizeof(buf), "%lld\n", bytes);
+/* Heat of the sampled VMA containing addr, 0 if unknown */
+static uint16_t heat_at(const vma_list_t *sampled, unsigned long addr) {
+    if (!sampled)
+        return 0;
+    for (size_t i = 0; i < sampled->n; i++) {
+        const vma_t *v = &sampled->v[i];
+        if (addr >= v->start && addr < v->end)
+            return (v->rss_kb > 0) ? (uint16_t)(v->ref_kb * 1000 / v->rss_kb) : 0;
     }
+    return 0;
+}
 
-    if (!quiet)
-        printf("[+] Applying temporary limit %s to %s\n", buf, ctx->limit_path);
+/*
+ * Scan /proc/<pid>/pagemap over the VMAs that smaps says hold swap and
+ * collect swapped pages into address runs.
+ */
+static int manifest_build(const target_t *t, const vma_list_t *vmas,
+                          const vma_list_t *sampled, manifest_t *m) {
+    int fd = openat(t->procfd, "pagemap", O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return -1;
 
-    if (write_file(ctx->limit_path, buf) != 0) {
-        fprintf(stderr, "Failed to set limit at %s: %s\n", ctx->limit_path, strerror(errno));
+    uint64_t *ents = malloc(PAGEMAP_BATCH * sizeof(uint64_t));
+    if (!ents) {
+        close(fd);
         return -1;
     }
-    return 0;
-}
 
-/* Restore original limit or set to max */
-static void restore_limit(const cgroup_ctx_t *ctx, int quiet) {
-    if (ctx->ver == CGROUP_NONE) return;
+    long psize = sysconf(_SC_PAGESIZE);
+    memset(m, 0, sizeof(*m));
+    memcpy(m->hdr.magic, MANIFEST_MAGIC, sizeof(m->hdr.magic));
+    m->hdr.version = MANIFEST_VERSION;
+    m->hdr.flags = sampled ? MANIFEST_HEAT : 0;
+    m->hdr.pid = t->pid;
+    m->hdr.page_size = (uint32_t)psize;
+    m->hdr.start_time = read_start_time(t);
+    size_t cap = 0;
+    int rc = 0;
 
-    const char *val = NULL;
-    char fallback[16];
+    for (size_t i = 0; i < vmas->n && rc == 0; i++) {
+        const vma_t *v = &vmas->v[i];
+        if (v->swap_kb <= 0)
+            continue;
 
-    if (ctx->had_backup && ctx->backup_limit[0] != '\0') {
-        val = ctx->backup_limit;
-    } else {
-        if (ctx->ver == CGROUP_V2) {
-            strcpy(fallback, "max");
-        } else {
-            /* v1: a very large number, e.g., "9223372036854771712" (LLONG_MAX-ish) */
-            strcpy(fallback, "9223372036854771712");
-        }
-        val = fallback;
-    }
+        uint16_t heat = heat_at(sampled, v->start);
+        manifest_run_t *run = NULL;
+        unsigned long addr = v->start;
 
-    if (!quiet)
-        printf("[+] Restoring limit at %s to '%s'\n", ctx->limit_path, val);
+        while (addr < v->end) {
+            size_t want = (v->end - addr) / (unsigned long)psize;
+            if (want > PAGEMAP_BATCH) want = PAGEMAP_BATCH;
+            off_t off = (off_t)(addr / (unsigned long)psize) * (off_t)sizeof(uint64_t);
+            ssize_t got = pread(fd, ents, want * sizeof(uint64_t), off);
+            if (got <= 0) {
+                rc = -1;
+                break;
+            }
+            size_t nent = (size_t)got / sizeof(uint64_t);
 
-    char tmp[128];
-    snprintf(tmp, sizeof(tmp), "%s\n", val);
-    if (write_file(ctx->limit_path, tmp) != 0) {
-        fprintf(stderr, "[!] Failed to restore limit at %s: %s\n",
-                ctx->limit_path, strerror(errno));
+            for (size_t k = 0; k < nent; k++, addr += (unsigned long)psize) {
+                uint64_t e = ents[k];
+                if (!(e & PM_SWAP) || (e & PM_PRESENT)) {
+                    run = NULL;
+                    continue;
+                }
+                if (run && run->start + (uint64_t)run->npages * (uint64_t)psize == addr) {
+                    run->npages++;
+                } else {
+                    if (manifest_add_run(m, &cap, addr, PM_SWAP_OFFSET(e), heat) != 0) {
+                        rc = -1;
+                        break;
+                    }
+                    run = &m->runs[m->hdr.nruns - 1];
+                }
+                m->hdr.npages++;
+            }
+            if (rc != 0)
+                break;
+        }
     }
+
+    free(ents);
+    close(fd);
+    return rc;
 }
 
-/* Cleanup group dir (best effort) */
-static void cleanup_cgroup(const cgroup_ctx_t *ctx, int quiet) {
-    if (ctx->group_dir[0] == '\0')
-        return;
-    if (rmdir(ctx->group_dir) != 0) {
-        if (!quiet)
-            fprintf(stderr, "[!] Could not remove %s: %s\n",
-                    ctx->group_dir, strerror(errno));
-    } else {
-        if (!quiet)
-            printf("[+] Removed cgroup %s\n", ctx->group_dir);
+static int manifest_write(const char *path, const manifest_t *m) {
+    char tmp[576];
+    snprintf(tmp, sizeof(tmp), "%s.tmp", path);
+    FILE *fp = fopen(tmp, "wb");
+    if (!fp) return -1;
+
+    int ok = fwrite(&m->hdr, sizeof(m->hdr), 1, fp) == 1 &&
+             (!(m->hdr.flags & MANIFEST_PARKED) ||
+              fwrite(&m->park, sizeof(m->park), 1, fp) == 1) &&
+             (m->hdr.nruns == 0 ||
+              fwrite(m->runs, sizeof(manifest_run_t), m->hdr.nruns, fp) == m->hdr.nruns);
+    if (fclose(fp) != 0)
+        ok = 0;
+    if (!ok || rename(tmp, path) != 0) {
+        unlink(tmp);
+        return -1;
     }
+    return 0;
+}
+
+static int manifest_read(const char *path, manifest_t *m) {
+    memset(m, 0, sizeof(*m));
+    FILE *fp = fopen(path, "rb");
+    if (!fp) return -1;
+
+    if (fread(&m->hdr, sizeof(m->hdr), 1, fp) != 1 ||
+        memcmp(m->hdr.magic, MANIFEST_MAGIC, sizeof(m->hdr.magic)) != 0 ||
+        m->hdr.version < 1 || m->hdr.version > MANIFEST_VERSION ||
+        (m->hdr.version < 2 && (m->hdr.flags & MANIFEST_PARKED)) ||
+        ((m->hdr.flags & MANIFEST_PARKED) && fread(&m->park, sizeof(m->park), 1, fp) != 1)) {
+        fclose(fp);
+        errno = EINVAL;
+        return -1;
+    }
+    m->park.origin[sizeof(m->park.origin) - 1] = '\0';
+    m->park.origin_freezer[sizeof(m->park.origin_freezer) - 1] = '\0';
+    if (m->hdr.nruns) {
+        m->runs = malloc(m->hdr.nruns * sizeof(manifest_run_t));
+        if (!m->runs ||
+            fread(m->runs, sizeof(manifest_run_t), m->hdr.nruns, fp) != m->hdr.nruns) {
+            free(m->runs);
+            m->runs = NULL;
+            fclose(fp);
+            errno = EINVAL;
+            return -1;
+        }
+    }
+    fclose(fp);
+    return 0;
+}
+
+static void manifest_free(manifest_t *m) {
+    free(m->runs);
+    m->runs = NULL;
+}
+
+static int cmp_run_swap(const void *a, const void *b) {
+    const manifest_run_t *x = a, *y = b;
+    return (x->swap_off > y->swap_off) - (x->swap_off < y->swap_off);
+}
+
+static int cmp_run_addr(const void *a, const void *b) {
+    const manifest_run_t *x = a, *y = b;
+    return (x->start > y->start) - (x->start < y->start);
+}
+
+static int cmp_run_hot(const void *a, const void *b) {
+    const manifest_run_t *x = a, *y = b;
+    if (x->heat != y->heat)
+        return (x->heat < y->heat) - (x->heat > y->heat);
+    return cmp_run_swap(a, b);
+}
+
+static void manifest_sort(manifest_t *m, manifest_order_t order) {
+    int (*cmp)(const void *, const void *) = cmp_run_swap;
+    if (order == ORDER_ADDR)
+        cmp = cmp_run_addr;
+    else if (order == ORDER_HOT)
+        cmp = cmp_run_hot;
+    qsort(m->runs, m->hdr.nruns, sizeof(manifest_run_t), cmp);
+}
+
+/* ---------- parallel prefetch ---------- */
+
+typedef struct {
+    const target_t *t;
+    const manifest_t *m;
+    size_t first;                    /* this worker takes runs first, first+stride, ... */
+    size_t stride;
+    int quiet;
+    long long bytes;                 /* out: bytes advised */
+} prefetch_job_t;
+
+#define PREFETCH_RUNS_PER_CALL 64
+
+/*
+ * Fault the pages of iov back in by reading one byte of each page through
+ * process_vm_readv(): that waits for the readahead I/O and maps the pages,
+ * so the target finds them resident rather than in the swap cache.
+ */
+static void touch_ranges(const target_t *t, const struct iovec *iov, size_t n, long psize) {
+    struct iovec remote[MADV_IOV_BATCH];
+    char sink[MADV_IOV_BATCH];
+    struct iovec local = { sink, 0 };
+    size_t nr = 0;
+
+    for (size_t i = 0; i < n; i++) {
+        unsigned long a = (unsigned long)iov[i].iov_base;
+        unsigned long end = a + iov[i].iov_len;
+        for (; a < end; a += (unsigned long)psize) {
+            remote[nr].iov_base = (void *)a;
+            remote[nr].iov_len = 1;
+            if (++nr == MADV_IOV_BATCH) {
+                local.iov_len = nr;
+                process_vm_readv(t->pid, &local, 1, remote, nr, 0);
+                nr = 0;
+            }
+        }
+    }
+    if (nr) {
+        local.iov_len = nr;
+        process_vm_readv(t->pid, &local, 1, remote, nr, 0);
+    }
+}
+
+/*
+ * Workers interleave over the sorted runs so the front of the order is
+ * fetched first no matter how many threads there are.  Each batch is
+ * advised MADV_WILLNEED (async swap readahead) and then touched.
+ */
+static void *prefetch_worker(void *arg) {
+    prefetch_job_t *job = arg;
+    const manifest_t *m = job->m;
+    iov_list_t iov = {0};
+
+    for (size_t i = job->first; i < m->hdr.nruns; i += job->stride) {
+        const manifest_run_t *r = &m->runs[i];
+        iov_add(&iov, (unsigned long)r->start,
+                (unsigned long)(r->start + (uint64_t)r->npages * m->hdr.page_size));
+        if (iov.n >= PREFETCH_RUNS_PER_CALL || i + job->stride >= m->hdr.nruns) {
+            long long r = advise_ranges(job->t->pidfd, iov.iov, iov.n, MADV_WILLNEED, job->quiet);
+            if (r < 0)
+                break;
+            job->bytes += r;
+            touch_ranges(job->t, iov.iov, iov.n, (long)m->hdr.page_size);
+            iov.n = 0;
+        }
+    }
+    free_iovs(&iov);
+    return NULL;
+}
+
+/* Prefetch every run from 'jobs' threads; returns bytes advised */
+static long long prefetch_manifest(const target_t *tgt, const manifest_t *m,
+                                   int jobs, int quiet) {
+    if (jobs < 1) jobs = 1;
+    if ((uint64_t)jobs > m->hdr.nruns && m->hdr.nruns > 0) jobs = (int)m->hdr.nruns;
+
+    prefetch_job_t *pj = calloc((size_t)jobs, sizeof(*pj));
+    pthread_t *tids = calloc((size_t)jobs, sizeof(*tids));
+    if (!pj || !tids) {
+        free(pj);
+        free(tids);
+        return -1;
+    }
+
+    for (int t = 0; t < jobs; t++) {
+        pj[t].t = tgt;
+        pj[t].m = m;
+        pj[t].first = (size_t)t;
+        pj[t].stride = (size_t)jobs;
+        pj[t].quiet = quiet;
+    }
+
+    int started = 0;
+    for (int t = 1; t < jobs; t++) {
+        if (pthread_create(&tids[t], NULL, prefetch_worker, &pj[t]) != 0)
+            break;
+        started = t;
+    }
+    /* Share 0, and any share whose thread could not be started, runs here */
+    prefetch_worker(&pj[0]);
+    for (int t = started + 1; t < jobs; t++)
+        prefetch_worker(&pj[t]);
+
+    long long total = 0;
+    for (int t = 0; t < jobs; t++) {
+        if (t >= 1 && t <= started)
+            pthread_join(tids[t], NULL);
+        total += pj[t].bytes;
+    }
+    free(pj);
+    free(tids);
+    return total;
+}
+
+/* ---------- sharded pageout (-j with madvise) ---------- */
+
+/* A range to advise and the resident memory it is expected to cover */
+typedef struct {
+    unsigned long start, end;
+    long kb;
+} wrange_t;
+
+typedef struct {
+    wrange_t *r;
+    size_t n, cap;
+    long total_kb;
+} wrange_list_t;
+
+typedef struct {
+    int pidfd;
+    int advice;
+    int quiet;
+    iov_list_t iov;
+    long kb;                /* resident share assigned to this shard */
+    long long bytes;        /* address space advised */
+    double secs;
+} shard_t;
+
+static int wrange_add(wrange_list_t *l, unsigned long start, unsigned long end, long kb) {
+    if (l->n == l->cap) {
+        size_t ncap = l->cap ? l->cap * 2 : 256;
+        wrange_t *nr = realloc(l->r, ncap * sizeof(*nr));
+        if (!nr) return -1;
+        l->r = nr;
+        l->cap = ncap;
+    }
+    l->r[l->n].start = start;
+    l->r[l->n].end = end;
+    l->r[l->n].kb = kb;
+    l->n++;
+    l->total_kb += kb;
+    return 0;
+}
+
+static void free_wranges(wrange_list_t *l) {
+    free(l->r);
+    memset(l, 0, sizeof(*l));
+}
+
+/*
+ * Deal the ranges out to 'n' shards in address order, each taking about
+ * total_kb/n of resident memory.  A range that straddles a shard boundary
+ * is cut at the page proportional to its resident share, assuming its
+ * resident pages are spread evenly.
+ */
+static int shard_ranges(const wrange_list_t *l, shard_t *sh, int n) {
+    unsigned long psize = (unsigned long)sysconf(_SC_PAGESIZE);
+    long per = (l->total_kb + n - 1) / n;
+    int s = 0;
+
+    for (size_t i = 0; i < l->n; i++) {
+        unsigned long a = l->r[i].start;
+        unsigned long end = l->r[i].end;
+        long left = l->r[i].kb;
+
+        while (s < n - 1 && sh[s].kb + left > per) {
+            long take = per - sh[s].kb;
+            unsigned long cut = a + (unsigned long)((double)(end - a) * take / left);
+            cut -= cut % psize;
+            if (cut > a && cut < end) {
+                if (iov_add(&sh[s].iov, a, cut) != 0)
+                    return -1;
+                sh[s].kb += take;
+                left -= take;
+                a = cut;
+            }
+            s++;
+        }
+        if (iov_add(&sh[s].iov, a, end) != 0)
+            return -1;
+        sh[s].kb += left;
+    }
+    return 0;
+}
+
+static void *shard_worker(void *arg) {
+    shard_t *sh = arg;
+    double t0 = now_secs();
+    sh->bytes = advise_ranges(sh->pidfd, sh->iov.iov, sh->iov.n, sh->advice, sh->quiet);
+    sh->secs = now_secs() - t0;
+    return NULL;
+}
+
+/*
+ * Threads worth starting for 'l': one per MADV_CHUNK of resident memory.
+ * shard_ranges cuts inside ranges, so the range count is no limit.
+ */
+static int shard_jobs(const wrange_list_t *l, int jobs) {
+    long chunk_kb = (long)(MADV_CHUNK / 1024);
+    long max_jobs = (l->total_kb + chunk_kb - 1) / chunk_kb;
+    if (jobs > max_jobs) jobs = (int)max_jobs;
+    return jobs < 1 ? 1 : jobs;
+}
+
+/*
+ * Advise the ranges from 'jobs' threads, one balanced shard each, and
+ * report per-shard and overall swap-out throughput.  Returns bytes advised,
+ * -1 if any shard failed.
+ */
+static long long advise_sharded(int pidfd, const wrange_list_t *l, int advice,
+                                int jobs, int quiet) {
+    jobs = shard_jobs(l, jobs);
+
+    shard_t *sh = calloc((size_t)jobs, sizeof(*sh));
+    pthread_t *tids = calloc((size_t)jobs, sizeof(*tids));
+    if (!sh || !tids || shard_ranges(l, sh, jobs) != 0) {
+        if (sh)
+            for (int i = 0; i < jobs; i++)
+                free_iovs(&sh[i].iov);
+        free(sh);
+        free(tids);
+        return -1;
+    }
+
+    long long out_before = read_vmstat("pswpout");
+    double t0 = now_secs();
+
+    int started = 0;
+    for (int i = 0; i < jobs; i++) {
+        sh[i].pidfd = pidfd;
+        sh[i].advice = advice;
+        sh[i].quiet = quiet;
+    }
+    for (int i = 1; i < jobs; i++) {
+        if (pthread_create(&tids[i], NULL, shard_worker, &sh[i]) != 0)
+            break;
+        started = i;
+    }
+    /* Shard 0, and any shard whose thread could not be started, runs here */
+    shard_worker(&sh[0]);
+    for (int i = started + 1; i < jobs; i++)
+        shard_worker(&sh[i]);
+
+    long long total = 0;
+    int failed = 0;
+    for (int i = 0; i < jobs; i++) {
+        if (i >= 1 && i <= started)
+            pthread_join(tids[i], NULL);
+        if (sh[i].bytes < 0)
+            failed = 1;
+        else
+            total += sh[i].bytes;
+    }
+    double elapsed = now_secs() - t0;
+    long long out_after = read_vmstat("pswpout");
+
+    if (!quiet && jobs > 1) {
+        for (int i = 0; i < jobs; i++) {
+            if (sh[i].bytes < 0) {
+                printf("    shard %2d: %5zu range(s), %9ld kB resident, failed\n",
+                       i, sh[i].iov.n, sh[i].kb);
+                continue;
+            }
+            /* Rate over what the kernel accepted, not what was planned */
+            printf("    shard %2d: %5zu range(s), %9ld kB resident, %9lld kB advised,"
+                   " %6.2f s, %8.1f MB/s\n",
+                   i, sh[i].iov.n, sh[i].kb, sh[i].bytes / 1024, sh[i].secs,
+                   sh[i].secs > 0 ? sh[i].bytes / 1048576.0 / sh[i].secs : 0.0);
+        }
+        if (!failed && out_before >= 0 && out_after >= out_before && elapsed > 0) {
+            double mb = (double)(out_after - out_before) * sysconf(_SC_PAGESIZE) / 1048576.0;
+            printf("[+] Swapped out %.1f MB system-wide in %.2f s (%.1f MB/s) from %d shard(s)\n",
+                   mb, elapsed, mb / elapsed, jobs);
+        }
+    }
+
+    for (int i = 0; i < jobs; i++)
+        free_iovs(&sh[i].iov);
+    free(sh);
+    free(tids);
+    return failed ? -1 : total;
+}
+
+/* ---------- cgroup detection & setup ---------- */
+
+static cgroup_version_t detect_cgroup_version(void) {
+    /* v2 unified if /sys/fs/cgroup/cgroup.controllers exists */
+    if (file_exists("/sys/fs/cgroup/cgroup.controllers")) {
+        return CGROUP_V2;
+    }
+    /* v1 memory controller */
+    if (file_exists("/sys/fs/cgroup/memory")) {
+        return CGROUP_V1;
+    }
+    return CGROUP_NONE;
+}
+
+/* Creates parent swapout directory if needed */
+static int ensure_dir(const char *path) {
+    struct stat st;
+    if (stat(path, &st) == 0) {
+        if (S_ISDIR(st.st_mode))
+            return 0;
+        errno = ENOTDIR;
+        return -1;
+    }
+    if (mkdir(path, 0755) != 0) {
+        return -1;
+    }
+    return 0;
+}
+
+static int is_number_str(const char *s) {
+    if (!s || !*s)
+        return 0;
+    for (; *s; s++) {
+        if (!isdigit((unsigned char)*s))
+            return 0;
+    }
+    return 1;
+}
+
+/* Mount point of the hierarchy that carries the memory controller */
+static const char *cgroup_mount(cgroup_version_t ver) {
+    return (ver == CGROUP_V2) ? "/sys/fs/cgroup" : "/sys/fs/cgroup/memory";
+}
+
+/* Setup cgroup paths for a given pid */
+typedef struct {
+    cgroup_version_t ver;
+    int  worker;               /* pool slot, -1 if none acquired */
+    int  lock_fd;              /* flock()ed /run/swapout/pool/worker-NNN.lock */
+    int  moved;                /* target was moved into group_dir */
+    char group_dir[PATH_MAX];  /* /sys/fs/cgroup/.../swapout/worker-NNN */
+    char procs_path[PATH_MAX + 32];  /* .../cgroup.procs */
+    char limit_path[PATH_MAX + 32];  /* memory.high or memory.limit_in_bytes */
+    char backup_limit[128];    /* original limit text */
+    int  had_backup;
+    char orig_cgroup[256];     /* target's cgroup before the move, relative to mount */
+    struct {
+        char path[PATH_MAX + 32];
+        char orig[64];
+    } knobs[4];                /* other interface files changed, restored in reverse */
+    int  nknobs;
+} cgroup_ctx_t;
+
+/* Returns 1 if the cgroup has no member processes, 0 if it has, -1 on error */
+static int cgroup_is_empty(const char *dir) {
+    char path[PATH_MAX + 32];
+    snprintf(path, sizeof(path), "%s/cgroup.procs", dir);
+    char *procs = read_file(path);
+    if (!procs)
+        return -1;
+    rtrim(procs);
+    int empty = (procs[0] == '\0');
+    free(procs);
+    return empty;
+}
+
+/*
+ * Path of the target's cgroup in the v1 hierarchy carrying 'controller',
+ * or in the v2 unified hierarchy when controller is NULL.
+ */
+static int read_proc_cgroup_ctrl(const target_t *t, const char *controller,
+                                 char *out, size_t outsz) {
+    FILE *fp = target_fopen(t, "cgroup", "r");
+    if (!fp) return -1;
+
+    char line[1024];
+    int found = 0;
+    while (!found && fgets(line, sizeof(line), fp)) {
+        /* hierarchy-ID:controller-list:cgroup-path */
+        char *ctrl = strchr(line, ':');
+        if (!ctrl) continue;
+        *ctrl++ = '\0';
+        char *cpath = strchr(ctrl, ':');
+        if (!cpath) continue;
+        *cpath++ = '\0';
+        rtrim(cpath);
+
+        if (!controller) {
+            found = (strcmp(line, "0") == 0 && ctrl[0] == '\0');
+        } else {
+            for (char *tok = strtok(ctrl, ","); tok; tok = strtok(NULL, ",")) {
+                if (strcmp(tok, controller) == 0) {
+                    found = 1;
+                    break;
+                }
+            }
+        }
+        if (found)
+            snprintf(out, outsz, "%s", cpath);
+    }
+    fclose(fp);
+    return found ? 0 : -1;
+}
+
+static int read_proc_cgroup(const target_t *t, cgroup_version_t ver, char *out, size_t outsz) {
+    return read_proc_cgroup_ctrl(t, ver == CGROUP_V2 ? NULL : "memory", out, outsz);
+}
+
+/* Path of cgroup.procs for <mount><rel> (rel "/" is the root) */
+static void cgroup_procs_path(const char *mount, const char *rel, char *out, size_t outsz) {
+    snprintf(out, outsz, "%s%s/cgroup.procs", mount, strcmp(rel, "/") == 0 ? "" : rel);
+}
+
+/* ---------- mutation journal ---------- */
+
+/*
+ * Every cgroup mutation (move, limit, knob, freeze) is journaled before it
+ * is applied, as the write that undoes it, to /run/swapout/<our pid>.json.
+ * The normal paths clear an entry once they have undone it themselves.
+ *
+ * SIGINT/SIGTERM/SIGHUP/SIGQUIT replay the in-memory copy in reverse from
+ * the handler using only open/write/close on precomputed buffers.  After
+ * SIGKILL or a crash, "swapout --recover" replays every journal whose owner
+ * is gone.  Moves are only undone while the moved process is still the one
+ * that was journaled (pidfd in the handler, start time in --recover).
+ */
+#define JOURNAL_MAX       16
+
+typedef struct {
+    volatile sig_atomic_t active;
+    char   path[PATH_MAX + 32];    /* file the undo value is written to */
+    char   undo[130];              /* value including the trailing newline */
+    size_t undo_len;
+    pid_t  pid;                    /* moves: the moved process, else 0 */
+    unsigned long long start;      /* moves: its start time */
+    int    pidfd;                  /* moves: its pidfd (borrowed), else -1 */
+} journal_entry_t;
+
+static struct {
+    pid_t owner;                   /* 0 until journal_open() in this process */
+    unsigned long long owner_start;
+    char  file[64];
+    char  tmp[72];
+    volatile sig_atomic_t n;
+    journal_entry_t e[JOURNAL_MAX];
+} jr;
+
+static volatile sig_atomic_t jr_replaying;
+
+static const int journal_signals[] = { SIGINT, SIGTERM, SIGHUP, SIGQUIT };
+
+static void json_put_str(FILE *fp, const char *s) {
+    fputc('"', fp);
+    for (; *s; s++) {
+        unsigned char c = (unsigned char)*s;
+        if (c == '"' || c == '\\')
+            fprintf(fp, "\\%c", c);
+        else if (c == '\n')
+            fputs("\\n", fp);
+        else if (c < 0x20)
+            fprintf(fp, "\\u%04x", c);
+        else
+            fputc(c, fp);
+    }
+    fputc('"', fp);
+}
+
+/* "key": "string" within one line; handles the escapes json_put_str() emits */
+static int json_get_str(const char *line, const char *key, char *out, size_t outsz) {
+    char pat[64];
+    snprintf(pat, sizeof(pat), "\"%s\": \"", key);
+    const char *p = strstr(line, pat);
+    if (!p || outsz == 0)
+        return -1;
+    p += strlen(pat);
+
+    size_t n = 0;
+    for (; *p && *p != '"'; p++) {
+        char c = *p;
+        if (c == '\\') {
+            p++;
+            if (*p == 'n') {
+                c = '\n';
+            } else if (*p == 'u') {
+                unsigned int u;
+                if (sscanf(p + 1, "%4x", &u) != 1)
+                    return -1;
+                c = (char)u;
+                p += 4;
+            } else if (*p) {
+                c = *p;
+            } else {
+                return -1;
+            }
+        }
+        if (n + 1 >= outsz)
+            return -1;
+        out[n++] = c;
+    }
+    out[n] = '\0';
+    return *p == '"' ? 0 : -1;
+}
+
+static unsigned long long json_get_ull(const char *line, const char *key) {
+    char pat[64];
+    snprintf(pat, sizeof(pat), "\"%s\": ", key);
+    const char *p = strstr(line, pat);
+    return p ? strtoull(p + strlen(pat), NULL, 10) : 0;
+}
+
+/* Rewrite the journal file (write + fsync + rename), or remove it when empty */
+static int journal_sync(void) {
+    int live = 0;
+    for (int i = 0; i < jr.n; i++)
+        live += jr.e[i].active ? 1 : 0;
+    if (!live) {
+        if (unlink(jr.file) != 0 && errno != ENOENT)
+            return -1;
+        return 0;
+    }
+
+    FILE *fp = fopen(jr.tmp, "w");
+    if (!fp)
+        return -1;
+    fprintf(fp, "{\n  \"owner\": %d,\n  \"owner_start\": %llu,\n  \"entries\": [\n",
+            (int)jr.owner, jr.owner_start);
+    int first = 1;
+    for (int i = 0; i < jr.n; i++) {
+        const journal_entry_t *e = &jr.e[i];
+        if (!e->active)
+            continue;
+        fprintf(fp, "%s    {\"path\": ", first ? "" : ",\n");
+        json_put_str(fp, e->path);
+        fputs(", \"undo\": ", fp);
+        json_put_str(fp, e->undo);
+        fprintf(fp, ", \"pid\": %d, \"start\": %llu}", (int)e->pid, e->start);
+        first = 0;
+    }
+    fputs("\n  ]\n}\n", fp);
+
+    int ok = fflush(fp) == 0 && fsync(fileno(fp)) == 0;
+    int saved = errno;
+    if (fclose(fp) != 0 && ok) {
+        ok = 0;
+        saved = errno;
+    }
+    if (!ok || rename(jr.tmp, jr.file) != 0) {
+        if (ok)
+            saved = errno;
+        unlink(jr.tmp);
+        errno = saved;
+        return -1;
+    }
+    return 0;
+}
+
+/* Undo every live entry, newest first.  Async-signal-safe. */
+static void journal_replay_signal(int sig) {
+    if (!jr_replaying && jr.owner == getpid()) {
+        jr_replaying = 1;
+        for (int i = jr.n - 1; i >= 0; i--) {
+            const journal_entry_t *e = &jr.e[i];
+            if (!e->active)
+                continue;
+            if (e->pidfd >= 0 &&
+                syscall(SYS_pidfd_send_signal, e->pidfd, 0, NULL, 0) != 0)
+                continue;
+            int fd = open(e->path, O_WRONLY | O_CLOEXEC);
+            if (fd < 0)
+                continue;
+            ssize_t w = write(fd, e->undo, e->undo_len);
+            (void)w;
+            close(fd);
+        }
+        unlink(jr.tmp);
+        unlink(jr.file);
+    }
+    /* SA_RESETHAND restored the default action; it fires once we return */
+    raise(sig);
+}
+
+/* Set up this process's journal and the signal handlers that replay it */
+static int journal_open(void) {
+    pid_t self = getpid();
+    if (jr.owner == self)
+        return 0;
+    if (ensure_dir(POOL_RUN_DIR) != 0)
+        return -1;
+
+    /* A forked batch child starts with its parent's (empty) copy */
+    jr.n = 0;
+    jr.owner = self;
+    target_t me;
+    if (target_open(self, &me) == 0) {
+        jr.owner_start = read_start_time(&me);
+        target_close(&me);
+    }
+    snprintf(jr.file, sizeof(jr.file), POOL_RUN_DIR "/%d.json", (int)self);
+    snprintf(jr.tmp, sizeof(jr.tmp), "%s.tmp", jr.file);
+
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = journal_replay_signal;
+    sa.sa_flags = SA_RESETHAND;
+    sigfillset(&sa.sa_mask);
+    for (size_t i = 0; i < sizeof(journal_signals) / sizeof(journal_signals[0]); i++)
+        sigaction(journal_signals[i], &sa, NULL);
+    return 0;
+}
+
+/*
+ * Record that writing 'undo' to 'path' reverts the mutation about to be
+ * made.  t is the moved process for cgroup moves, NULL otherwise.
+ */
+static int journal_record(const char *path, const char *undo, const target_t *t) {
+    if (journal_open() != 0)
+        return -1;
+
+    int slot = jr.n;
+    for (int i = 0; i < jr.n; i++) {
+        if (!jr.e[i].active) {
+            slot = i;
+            break;
+        }
+    }
+    if (slot >= JOURNAL_MAX) {
+        errno = ENOSPC;
+        return -1;
+    }
+
+    journal_entry_t *e = &jr.e[slot];
+    snprintf(e->path, sizeof(e->path), "%s", path);
+    snprintf(e->undo, sizeof(e->undo), "%s\n", undo);
+    e->undo_len = strlen(e->undo);
+    e->pid = t ? t->pid : 0;
+    e->start = t ? read_start_time(t) : 0;
+    e->pidfd = t ? t->pidfd : -1;
+    /* Complete before the signal handler can see it */
+    atomic_signal_fence(memory_order_seq_cst);
+    e->active = 1;
+    if (slot == jr.n)
+        jr.n = slot + 1;
+
+    if (journal_sync() != 0) {
+        int saved = errno;
+        e->active = 0;
+        fprintf(stderr, "Cannot journal %s to %s: %s\n", path, jr.file, strerror(saved));
+        errno = saved;
+        return -1;
+    }
+    return 0;
+}
+
+/* The mutation on 'path' has been undone (or is meant to stay) */
+static void journal_clear(const char *path) {
+    if (jr.owner != getpid())
+        return;
+    for (int i = jr.n - 1; i >= 0; i--) {
+        if (jr.e[i].active && strcmp(jr.e[i].path, path) == 0) {
+            jr.e[i].active = 0;
+            break;
+        }
+    }
+    while (jr.n > 0 && !jr.e[jr.n - 1].active)
+        jr.n--;
+    if (journal_sync() != 0)
+        fprintf(stderr, "[!] Could not update journal %s: %s\n", jr.file, strerror(errno));
+}
+
+/*
+ * Replay the journals of swapout processes that are gone.  Returns the
+ * number of journals that could not be replayed completely.
+ */
+static int journal_recover(int quiet) {
+    DIR *dp = opendir(POOL_RUN_DIR);
+    if (!dp) {
+        if (!quiet)
+            printf("[+] recover: no journals in %s\n", POOL_RUN_DIR);
+        return 0;
+    }
+
+    int replayed = 0, failed = 0;
+    struct dirent *de;
+    while ((de = readdir(dp)) != NULL) {
+        int owner, len = 0;
+        if (sscanf(de->d_name, "%d.json%n", &owner, &len) != 1 ||
+            de->d_name[len] != '\0' || owner <= 0)
+            continue;
+
+        char file[PATH_MAX];
+        snprintf(file, sizeof(file), POOL_RUN_DIR "/%s", de->d_name);
+        char *buf = read_file(file);
+        if (!buf)
+            continue;
+
+        /* Still running: its own handlers and paths are in charge */
+        target_t o;
+        if (owner != getpid() && target_open(owner, &o) == 0) {
+            int alive = read_start_time(&o) == json_get_ull(buf, "owner_start");
+            target_close(&o);
+            if (alive) {
+                if (!quiet)
+                    printf("[+] recover: %s belongs to running swapout %d, skipped\n",
+                           file, owner);
+                free(buf);
+                continue;
+            }
+        }
+
+        journal_entry_t *e = calloc(JOURNAL_MAX, sizeof(*e));
+        if (!e) {
+            free(buf);
+            failed++;
+            continue;
+        }
+        int n = 0, bad = 0;
+        for (char *save, *line = strtok_r(buf, "\n", &save);
+             line; line = strtok_r(NULL, "\n", &save)) {
+            if (!strstr(line, "\"path\": "))
+                continue;
+            if (n >= JOURNAL_MAX ||
+                json_get_str(line, "path", e[n].path, sizeof(e[n].path)) != 0 ||
+                json_get_str(line, "undo", e[n].undo, sizeof(e[n].undo)) != 0) {
+                bad = 1;
+                continue;
+            }
+            e[n].pid = (pid_t)json_get_ull(line, "pid");
+            e[n].start = json_get_ull(line, "start");
+            n++;
+        }
+        free(buf);
+
+        if (!quiet)
+            printf("[+] recover: replaying %s (swapout %d, %d entr%s)\n",
+                   file, owner, n, n == 1 ? "y" : "ies");
+        for (int i = n - 1; i >= 0; i--) {
+            char shown[sizeof(e[i].undo)];
+            snprintf(shown, sizeof(shown), "%s", e[i].undo);
+            rtrim(shown);
+
+            if (e[i].pid > 0) {
+                target_t t;
+                int same = target_open(e[i].pid, &t) == 0;
+                if (same) {
+                    same = read_start_time(&t) == e[i].start;
+                    target_close(&t);
+                }
+                if (!same) {
+                    if (!quiet)
+                        printf("  pid %d is gone, not moving it to %s\n", e[i].pid, e[i].path);
+                    continue;
+                }
+            }
+            if (write_file(e[i].path, e[i].undo) != 0 && errno != ESRCH && errno != ENOENT) {
+                fprintf(stderr, "[!] recover: %s <- '%s': %s\n", e[i].path, shown, strerror(errno));
+                bad = 1;
+            } else if (!quiet) {
+                printf("  %s <- '%s'\n", e[i].path, shown);
+            }
+        }
+        free(e);
+
+        if (bad) {
+            failed++;
+        } else {
+            unlink(file);
+            replayed++;
+        }
+    }
+    closedir(dp);
+
+    if (!quiet)
+        printf("[+] recover: %d journal(s) replayed, %d failed\n", replayed, failed);
+    return failed;
+}
+
+/* ---------- worker cgroup pool ---------- */
+
+static void pool_group_dir(cgroup_version_t ver, char *out, size_t outsz) {
+    snprintf(out, outsz, "%s/swapout", cgroup_mount(ver));
+}
+
+/*
+ * v2: make sure the memory controller is delegated down to the workers.
+ * Both the root and the pool parent need "+memory" in subtree_control.
+ */
+static void pool_delegate_controllers(cgroup_version_t ver, int quiet) {
+    if (ver != CGROUP_V2)
+        return;
+
+    const char *levels[] = {
+        "/sys/fs/cgroup/cgroup.subtree_control",
+        "/sys/fs/cgroup/swapout/cgroup.subtree_control",
+    };
+    for (size_t i = 0; i < sizeof(levels) / sizeof(levels[0]); i++) {
+        char *cur = read_file(levels[i]);
+        int enabled = cur && strstr(cur, "memory") != NULL;
+        free(cur);
+        if (enabled)
+            continue;
+        if (write_file(levels[i], "+memory\n") != 0 && !quiet)
+            fprintf(stderr, "[!] Could not enable memory controller in %s: %s\n",
+                    levels[i], strerror(errno));
+    }
+}
+
+/*
+ * Lock pool slot idx without blocking.  Returns the lock fd, or -1 with
+ * errno == EWOULDBLOCK when another swapout holds the slot.
+ */
+static int pool_lock_worker(int idx) {
+    char path[128];
+    snprintf(path, sizeof(path), POOL_LOCK_DIR "/worker-%03d.lock", idx);
+
+    for (;;) {
+        int fd = open(path, O_RDWR | O_CREAT | O_CLOEXEC, 0600);
+        if (fd < 0)
+            return -1;
+        if (flock(fd, LOCK_EX | LOCK_NB) != 0) {
+            int saved = errno;
+            close(fd);
+            errno = saved;
+            return -1;
+        }
+        /* The GC may have unlinked the file between open() and flock() */
+        struct stat held, now;
+        if (fstat(fd, &held) == 0 && stat(path, &now) == 0 &&
+            held.st_ino == now.st_ino)
+            return fd;
+        close(fd);
+    }
+}
+
+static int pool_acquire(cgroup_ctx_t *ctx, int quiet) {
+    char base[64];
+    pool_group_dir(ctx->ver, base, sizeof(base));
+
+    if (ensure_dir(base) != 0) {
+        fprintf(stderr, "mkdir %s: %s\n", base, strerror(errno));
+        return -1;
+    }
+    pool_delegate_controllers(ctx->ver, quiet);
+
+    if (ensure_dir(POOL_RUN_DIR) != 0 || ensure_dir(POOL_LOCK_DIR) != 0) {
+        fprintf(stderr, "mkdir %s: %s\n", POOL_LOCK_DIR, strerror(errno));
+        return -1;
+    }
+
+    for (int i = 0; i < POOL_MAX_WORKERS; i++) {
+        int fd = pool_lock_worker(i);
+        if (fd < 0) {
+            if (errno == EWOULDBLOCK)
+                continue;
+            fprintf(stderr, "Failed to lock pool worker %d: %s\n", i, strerror(errno));
+            return -1;
+        }
+
+        snprintf(ctx->group_dir, sizeof(ctx->group_dir), "%s/worker-%03d", base, i);
+        if (ensure_dir(ctx->group_dir) != 0) {
+            fprintf(stderr, "mkdir %s: %s\n", ctx->group_dir, strerror(errno));
+            close(fd);
+            return -1;
+        }
+        /* Someone else's processes still live here; leave it alone */
+        if (cgroup_is_empty(ctx->group_dir) != 1) {
+            close(fd);
+            continue;
+        }
+
+        ctx->worker = i;
+        ctx->lock_fd = fd;
+        return 0;
+    }
+
+    ctx->group_dir[0] = '\0';
+    fprintf(stderr, "Worker pool exhausted (%d workers busy)\n", POOL_MAX_WORKERS);
+    return -1;
+}
+
+/* Unlock the worker; the lock file mtime records when it went idle */
+static void pool_release(cgroup_ctx_t *ctx) {
+    if (ctx->lock_fd < 0)
+        return;
+    futimens(ctx->lock_fd, NULL);
+    close(ctx->lock_fd);
+    ctx->lock_fd = -1;
+    ctx->worker = -1;
+}
+
+/*
+ * Remove workers that are empty and have been idle for at least idle_secs,
+ * plus empty per-PID groups left behind by older swapout versions.
+ * Returns the number of groups removed.
+ */
+static int pool_gc(cgroup_version_t ver, long idle_secs, int quiet) {
+    if (ver == CGROUP_NONE)
+        return 0;
+
+    char base[64];
+    pool_group_dir(ver, base, sizeof(base));
+    DIR *dp = opendir(base);
+    if (!dp)
+        return 0;
+    if (ensure_dir(POOL_RUN_DIR) != 0 || ensure_dir(POOL_LOCK_DIR) != 0) {
+        closedir(dp);
+        return 0;
+    }
+
+    time_t now = time(NULL);
+    int removed = 0;
+    struct dirent *de;
+
+    while ((de = readdir(dp)) != NULL) {
+        char dir[512];
+        int idx;
+        snprintf(dir, sizeof(dir), "%s/%s", base, de->d_name);
+
+        if (sscanf(de->d_name, "worker-%d", &idx) == 1 &&
+            idx >= 0 && idx < POOL_MAX_WORKERS) {
+            int fd = pool_lock_worker(idx);
+            if (fd < 0)
+                continue;   /* in use */
+
+            struct stat st;
+            if (fstat(fd, &st) == 0 && now - st.st_mtime >= idle_secs &&
+                cgroup_is_empty(dir) == 1 && rmdir(dir) == 0) {
+                char lock_path[128];
+                snprintf(lock_path, sizeof(lock_path),
+                         POOL_LOCK_DIR "/worker-%03d.lock", idx);
+                unlink(lock_path);
+                removed++;
+                if (!quiet)
+                    printf("[+] GC: removed idle worker %s\n", dir);
+            }
+            close(fd);
+        } else if (is_number_str(de->d_name)) {
+            if (cgroup_is_empty(dir) == 1 && rmdir(dir) == 0) {
+                removed++;
+                if (!quiet)
+                    printf("[+] GC: removed stale group %s\n", dir);
+            }
+        }
+    }
+    closedir(dp);
+    return removed;
+}
+
+static int setup_cgroup_for_pid(const target_t *t, cgroup_ctx_t *ctx, int quiet) {
+    pid_t pid = t->pid;
+
+    memset(ctx, 0, sizeof(*ctx));
+    ctx->worker = -1;
+    ctx->lock_fd = -1;
+    ctx->ver = detect_cgroup_version();
+    if (ctx->ver == CGROUP_NONE) {
+        fprintf(stderr, "No cgroup v1/v2 memory controller detected under /sys/fs/cgroup\n");
+        return -1;
+    }
+
+    if (read_proc_cgroup(t, ctx->ver, ctx->orig_cgroup, sizeof(ctx->orig_cgroup)) != 0) {
+        fprintf(stderr, "Could not determine current cgroup of pid %d\n", pid);
+        return -1;
+    }
+
+    if (pool_acquire(ctx, quiet) != 0)
+        return -1;
+
+    snprintf(ctx->procs_path, sizeof(ctx->procs_path), "%s/cgroup.procs", ctx->group_dir);
+    if (ctx->ver == CGROUP_V2) {
+        snprintf(ctx->limit_path, sizeof(ctx->limit_path), "%s/memory.high", ctx->group_dir);
+        if (!quiet)
+            printf("[+] cgroup v2 detected, using %s\n", ctx->group_dir);
+    } else {
+        snprintf(ctx->limit_path, sizeof(ctx->limit_path), "%s/memory.limit_in_bytes", ctx->group_dir);
+        if (!quiet)
+            printf("[+] cgroup v1 (memory) detected, using %s\n", ctx->group_dir);
+    }
+
+    /* Backup original limit, if readable */
+    char *orig = read_file(ctx->limit_path);
+    if (orig) {
+        rtrim(orig);
+        strncpy(ctx->backup_limit, orig, sizeof(ctx->backup_limit) - 1);
+        ctx->backup_limit[sizeof(ctx->backup_limit) - 1] = '\0';
+        free(orig);
+        ctx->had_backup = 1;
+        if (!quiet)
+            printf("[+] Original limit at %s: '%s'\n", ctx->limit_path, ctx->backup_limit);
+    } else {
+        ctx->had_backup = 0;
+        if (!quiet)
+            printf("[!] Could not read original limit at %s, will not restore.\n", ctx->limit_path);
+    }
+
+    /*
+     * v1 leaves existing charges behind on migration unless asked to move
+     * them; without this the limit only sees new allocations and the clamp
+     * never pushes anything out.
+     */
+    if (ctx->ver == CGROUP_V1) {
+        char mc_path[PATH_MAX + 32];
+        snprintf(mc_path, sizeof(mc_path), "%s/memory.move_charge_at_immigrate", ctx->group_dir);
+        if (write_file(mc_path, "1\n") != 0 && !quiet)
+            printf("[!] Could not enable charge migration (%s): existing memory stays "
+                   "charged to the original cgroup.\n", strerror(errno));
+    }
+
+    /* Move PID into this cgroup; cgroup.procs only takes numbers, so check first */
+    if (target_exited(t)) {
+        fprintf(stderr, "Process %d exited before it could be moved\n", pid);
+        return -1;
+    }
+    char pidbuf[32], back[PATH_MAX + 32];
+    snprintf(pidbuf, sizeof(pidbuf), "%d", pid);
+    cgroup_procs_path(cgroup_mount(ctx->ver), ctx->orig_cgroup, back, sizeof(back));
+    if (journal_record(back, pidbuf, t) != 0)
+        return -1;
+    if (write_file(ctx->procs_path, strcat(pidbuf, "\n")) != 0) {
+        fprintf(stderr, "Failed to move pid %d into %s: %s\n",
+                pid, ctx->procs_path, strerror(errno));
+        journal_clear(back);
+        return -1;
+    }
+    ctx->moved = 1;
+    if (!quiet)
+        printf("[+] Moved PID %d into %s (was %s)\n", pid, ctx->group_dir, ctx->orig_cgroup);
+
+    return 0;
+}
+
+/* The value restore_limit() puts back: the backup, or no limit at all */
+static const char *limit_restore_value(const cgroup_ctx_t *ctx) {
+    if (ctx->had_backup && ctx->backup_limit[0] != '\0')
+        return ctx->backup_limit;
+    /* v1: a very large number, e.g., "9223372036854771712" (LLONG_MAX-ish) */
+    return (ctx->ver == CGROUP_V2) ? "max" : "9223372036854771712";
+}
+
+/* Apply low memory limit */
+static int apply_low_limit(const cgroup_ctx_t *ctx, long limit_mb, int quiet) {
+    char buf[64];
+    if (ctx->ver == CGROUP_V2) {
+        /* memory.high uses "max" or byte value */
+        long long bytes = (long long)limit_mb * 1024LL * 1024LL;
+        snprintf(buf, sizeof(buf), "%lld\n", bytes);
+    } else {
+        long long bytes = (long long)limit_mb * 1024LL * 1024LL;
+        snprintf(buf, sizeof(buf), "%lld\n", bytes);
+    }
+
+    if (!quiet)
+        printf("[+] Applying temporary limit %s to %s\n", buf, ctx->limit_path);
+
+    if (journal_record(ctx->limit_path, limit_restore_value(ctx), NULL) != 0)
+        return -1;
+    if (write_file(ctx->limit_path, buf) != 0) {
+        fprintf(stderr, "Failed to set limit at %s: %s\n", ctx->limit_path, strerror(errno));
+        journal_clear(ctx->limit_path);
+        return -1;
+    }
+    return 0;
+}
+
+/* Restore original limit or set to max */
+static void restore_limit(const cgroup_ctx_t *ctx, int quiet) {
+    if (ctx->ver == CGROUP_NONE || ctx->limit_path[0] == '\0') return;
+
+    const char *val = limit_restore_value(ctx);
+
+    if (!quiet)
+        printf("[+] Restoring limit at %s to '%s'\n", ctx->limit_path, val);
+
+    char tmp[sizeof(ctx->backup_limit) + 2];
+    snprintf(tmp, sizeof(tmp), "%s\n", val);
+    if (write_file(ctx->limit_path, tmp) != 0) {
+        fprintf(stderr, "[!] Failed to restore limit at %s: %s\n",
+                ctx->limit_path, strerror(errno));
+    }
+    journal_clear(ctx->limit_path);
+}
+
+/* Set an interface file in the group, remembering its old value for restore_knobs() */
+static int cgroup_set_knob(cgroup_ctx_t *ctx, const char *name, const char *val, int quiet) {
+    if (ctx->nknobs >= (int)(sizeof(ctx->knobs) / sizeof(ctx->knobs[0]))) {
+        errno = ENOSPC;
+        return -1;
+    }
+
+    char path[PATH_MAX + 32];
+    snprintf(path, sizeof(path), "%s/%s", ctx->group_dir, name);
+    char *orig = read_file(path);
+    if (!orig)
+        return -1;
+    rtrim(orig);
+
+    if (journal_record(path, orig, NULL) != 0) {
+        free(orig);
+        return -1;
+    }
+    char buf[64];
+    snprintf(buf, sizeof(buf), "%s\n", val);
+    if (write_file(path, buf) != 0) {
+        int saved = errno;
+        journal_clear(path);
+        free(orig);
+        errno = saved;
+        return -1;
+    }
+
+    snprintf(ctx->knobs[ctx->nknobs].path, sizeof(ctx->knobs[0].path), "%s", path);
+    snprintf(ctx->knobs[ctx->nknobs].orig, sizeof(ctx->knobs[0].orig), "%s", orig);
+    ctx->nknobs++;
+    free(orig);
+
+    if (!quiet)
+        printf("[+] Set %s to '%s'\n", path, val);
+    return 0;
+}
+
+static void restore_knobs(cgroup_ctx_t *ctx, int quiet) {
+    while (ctx->nknobs > 0) {
+        ctx->nknobs--;
+        const char *path = ctx->knobs[ctx->nknobs].path;
+        char buf[80];
+        snprintf(buf, sizeof(buf), "%s\n", ctx->knobs[ctx->nknobs].orig);
+        if (write_file(path, buf) != 0)
+            fprintf(stderr, "[!] Failed to restore %s: %s\n", path, strerror(errno));
+        else if (!quiet)
+            printf("[+] Restored %s to '%s'\n", path, ctx->knobs[ctx->nknobs].orig);
+        journal_clear(path);
+    }
+}
+
+/* Read a "key value" counter from the group's memory.stat, -1 if missing */
+static long long cgroup_stat(const char *group_dir, const char *key) {
+    char path[PATH_MAX + 32];
+    snprintf(path, sizeof(path), "%s/memory.stat", group_dir);
+    FILE *fp = fopen(path, "r");
+    if (!fp) return -1;
+
+    char name[64];
+    long long val;
+    long long found = -1;
+    while (fscanf(fp, "%63s %lld", name, &val) == 2) {
+        if (strcmp(name, key) == 0) {
+            found = val;
+            break;
+        }
+    }
+    fclose(fp);
+    return found;
+}
+
+/*
+ * Steer where the group's pages go when reclaimed (cgroup v2, 6.8+ for
+ * memory.zswap.writeback).  zswap keeps them compressed in RAM and never
+ * writes back; disk bypasses zswap entirely.
+ */
+static int apply_swap_tier(cgroup_ctx_t *ctx, swap_tier_t tier, int quiet) {
+    if (tier == TIER_DEFAULT)
+        return 0;
+    if (ctx->ver != CGROUP_V2) {
+        fprintf(stderr, "--tier needs cgroup v2 (memory.zswap.*)\n");
+        return -1;
+    }
+
+    if (tier == TIER_ZSWAP) {
+        char *en = read_file("/sys/module/zswap/parameters/enabled");
+        if (!en || en[0] != 'Y')
+            fprintf(stderr, "[!] zswap is not enabled; pages will stay resident\n");
+        free(en);
+    }
+
+    const char *zmax = (tier == TIER_ZSWAP) ? "max" : "0";
+    const char *wb   = (tier == TIER_ZSWAP) ? "0" : "1";
+    if (cgroup_set_knob(ctx, "memory.zswap.max", zmax, quiet) != 0 ||
+        cgroup_set_knob(ctx, "memory.zswap.writeback", wb, quiet) != 0) {
+        fprintf(stderr, "Failed to set zswap tier on %s: %s\n",
+                ctx->group_dir, strerror(errno));
+        return -1;
+    }
+    return 0;
+}
+
+static void report_swap_tier(const cgroup_ctx_t *ctx) {
+    long long compressed = cgroup_stat(ctx->group_dir, "zswap");
+    long long original   = cgroup_stat(ctx->group_dir, "zswapped");
+
+    if (compressed < 0 || original < 0) {
+        printf("[!] memory.stat has no zswap counters\n");
+        return;
+    }
+    printf("[+] zswap: %lld kB stored in %lld kB", original / 1024, compressed / 1024);
+    if (compressed > 0)
+        printf(" (compression ratio %.2f)", (double)original / (double)compressed);
+    printf("\n");
+
+    char path[PATH_MAX + 32];
+    snprintf(path, sizeof(path), "%s/memory.swap.current", ctx->group_dir);
+    char *cur = read_file(path);
+    if (cur) {
+        rtrim(cur);
+        printf("[+] swap.current: %lld kB\n", atoll(cur) / 1024);
+        free(cur);
+    }
+}
+
+/* Move the target back where it came from and hand the worker back to the pool */
+static void release_cgroup(cgroup_ctx_t *ctx, const target_t *t, int quiet) {
+    pid_t pid = t->pid;
+
+    /* Once it has exited, the PID may belong to someone else */
+    if (ctx->moved && target_exited(t))
+        ctx->moved = 0;
+
+    char path[PATH_MAX + 32];
+    cgroup_procs_path(cgroup_mount(ctx->ver), ctx->orig_cgroup, path, sizeof(path));
+
+    if (ctx->moved) {
+        char pidbuf[32];
+        snprintf(pidbuf, sizeof(pidbuf), "%d\n", pid);
+        if (write_file(path, pidbuf) != 0) {
+            if (errno != ESRCH)
+                fprintf(stderr, "[!] Could not return pid %d to %s: %s\n",
+                        pid, ctx->orig_cgroup, strerror(errno));
+        } else if (!quiet) {
+            printf("[+] Returned PID %d to %s\n", pid, ctx->orig_cgroup);
+        }
+        ctx->moved = 0;
+    }
+    /* Moved back, gone, or deliberately left in the worker by --park */
+    if (ctx->orig_cgroup[0])
+        journal_clear(path);
+
+    if (ctx->worker >= 0 && !quiet)
+        printf("[+] Released worker %s\n", ctx->group_dir);
+    pool_release(ctx);
+}
+
+/* ---------- impact measurement ---------- */
+
+/*
+ * While swapout works (phase "during") and for a window afterwards
+ * (phase "after") a sampler thread records, every --impact-interval:
+ *   - run-queue delay of all target threads (/proc/<pid>/task/<tid>/schedstat)
+ *   - major faults (/proc/<pid>/stat field 12)
+ *   - memory PSI "some" stall time of the target's cgroup
+ * and an optional probe thread times a user command.  Each series is
+ * reported as percentiles per phase.
+ */
+enum { PHASE_DURING = 0, PHASE_AFTER, NPHASES };
+
+#define PROBE_TIMEOUT 10.0   /* seconds before a probe is killed */
+
+static const char *phase_names[NPHASES] = { "during", "after" };
+
+typedef struct {
+    double *v;
+    size_t n;
+    size_t cap;
+} series_t;
+
+typedef struct {
+    const target_t *t;         /* NULL for --cgroup targets */
+    const char *group_dir;     /* PSI source for --cgroup targets */
+    const char *probe_cmd;
+    double period;
+    atomic_int phase;
+    atomic_int stop;
+    pthread_t sampler;
+    pthread_t prober;
+    int have_sampler;
+    int have_prober;
+    series_t delay[NPHASES];   /* ms of run-queue wait per second */
+    series_t majflt[NPHASES];  /* major faults per second */
+    series_t psi[NPHASES];     /* % of time stalled on memory */
+    series_t probe[NPHASES];   /* probe latency in ms */
+    int probe_killed;          /* probes that hit PROBE_TIMEOUT */
+} impact_t;
+
+static void series_push(series_t *s, double v) {
+    if (s->n == s->cap) {
+        size_t ncap = s->cap ? s->cap * 2 : 64;
+        double *nv = realloc(s->v, ncap * sizeof(double));
+        if (!nv) return;
+        s->v = nv;
+        s->cap = ncap;
+    }
+    s->v[s->n++] = v;
+}
+
+static int cmp_double(const void *a, const void *b) {
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+/* Nearest-rank percentile of a sorted series */
+static double series_pct(const series_t *s, double pct) {
+    size_t idx = (size_t)(pct / 100.0 * (double)s->n + 0.5);
+    if (idx > 0) idx--;
+    if (idx >= s->n) idx = s->n - 1;
+    return s->v[idx];
+}
+
+/* Sum of run-queue wait (ns) over all threads of the target */
+static long long read_run_delay_ns(const target_t *t) {
+    int tfd = openat(t->procfd, "task", O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (tfd < 0) return -1;
+    DIR *dp = fdopendir(tfd);
+    if (!dp) {
+        close(tfd);
+        return -1;
+    }
+
+    long long total = 0;
+    struct dirent *de;
+    while ((de = readdir(dp)) != NULL) {
+        if (!is_number_str(de->d_name))
+            continue;
+        char name[300];
+        snprintf(name, sizeof(name), "%s/schedstat", de->d_name);
+        char *buf = read_file_at(dirfd(dp), name);
+        if (!buf)
+            continue;
+        unsigned long long run_ns, wait_ns;
+        if (sscanf(buf, "%llu %llu", &run_ns, &wait_ns) == 2)
+            total += (long long)wait_ns;
+        free(buf);
+    }
+    closedir(dp);
+    return total;
+}
+
+/* Field 12 of /proc/<pid>/stat (whole thread group) */
+static long long read_majflt(const target_t *t) {
+    char *buf = read_file_at(t->procfd, "stat");
+    if (!buf) return -1;
+
+    long long majflt = -1;
+    char *p = strrchr(buf, ')');
+    if (p) {
+        int field = 2;
+        for (p++; *p && field < 12; p++) {
+            if (*p == ' ')
+                field++;
+        }
+        majflt = strtoll(p, NULL, 10);
+    }
+    free(buf);
+    return majflt;
+}
+
+/* "some ... total=<usec>" from a pressure file */
+static long long read_psi_total_us(const char *path) {
+    char *buf = read_file(path);
+    if (!buf) return -1;
+    long long total = -1;
+    char *p = strstr(buf, "total=");
+    if (strncmp(buf, "some", 4) == 0 && p)
+        total = strtoll(p + 6, NULL, 10);
+    free(buf);
+    return total;
+}
+
+/* Memory pressure file of the group the target is in right now */
+static void impact_psi_path(const impact_t *im, char *out, size_t outsz) {
+    if (im->group_dir) {
+        snprintf(out, outsz, "%s/memory.pressure", im->group_dir);
+        return;
+    }
+    char cg[256];
+    if (detect_cgroup_version() == CGROUP_V2 &&
+        read_proc_cgroup(im->t, CGROUP_V2, cg, sizeof(cg)) == 0) {
+        snprintf(out, outsz, "/sys/fs/cgroup%s/memory.pressure", cg);
+        return;
+    }
+    /* v1 has no per-group PSI */
+    snprintf(out, outsz, "/proc/pressure/memory");
+}
+
+static void *impact_sampler(void *arg) {
+    impact_t *im = arg;
+    char psi_path[PATH_MAX + 32];
+
+    impact_psi_path(im, psi_path, sizeof(psi_path));
+    long long delay0 = im->t ? read_run_delay_ns(im->t) : -1;
+    long long flt0 = im->t ? read_majflt(im->t) : -1;
+    long long psi0 = read_psi_total_us(psi_path);
+    double t0 = now_secs();
+
+    while (!atomic_load(&im->stop)) {
+        if (im->t) {
+            if (target_wait_exit(im->t, im->period))
+                break;
+        } else {
+            sleep_double(im->period);
+        }
+
+        int ph = atomic_load(&im->phase);
+        double t1 = now_secs();
+        double dt = t1 - t0;
+        if (dt <= 0)
+            continue;
+
+        if (im->t) {
+            long long delay1 = read_run_delay_ns(im->t);
+            long long flt1 = read_majflt(im->t);
+            if (delay0 >= 0 && delay1 >= delay0)
+                series_push(&im->delay[ph], (double)(delay1 - delay0) / 1e6 / dt);
+            if (flt0 >= 0 && flt1 >= flt0)
+                series_push(&im->majflt[ph], (double)(flt1 - flt0) / dt);
+            delay0 = delay1;
+            flt0 = flt1;
+        }
+
+        /* The target may have changed groups (clamp worker and back) */
+        char now_path[PATH_MAX + 32];
+        impact_psi_path(im, now_path, sizeof(now_path));
+        long long psi1 = read_psi_total_us(now_path);
+        if (strcmp(now_path, psi_path) == 0 && psi0 >= 0 && psi1 >= psi0)
+            series_push(&im->psi[ph], (double)(psi1 - psi0) / 1e6 / dt * 100.0);
+        snprintf(psi_path, sizeof(psi_path), "%s", now_path);
+        psi0 = psi1;
+        t0 = t1;
+    }
+    return NULL;
+}
+
+/* Run the probe command back to back (one per period at most) and time it */
+static void *impact_prober(void *arg) {
+    impact_t *im = arg;
+
+    while (!atomic_load(&im->stop)) {
+        int ph = atomic_load(&im->phase);
+        double t0 = now_secs();
+        pid_t child = fork();
+        if (child == 0) {
+            int devnull = open("/dev/null", O_WRONLY);
+            if (devnull >= 0) {
+                dup2(devnull, STDOUT_FILENO);
+                dup2(devnull, STDERR_FILENO);
+            }
+            setpgid(0, 0);
+            execl("/bin/sh", "sh", "-c", im->probe_cmd, (char *)NULL);
+            _exit(127);
+        }
+        if (child < 0)
+            break;
+
+        /* Poll for the probe so a hung command cannot stall the run */
+        int status = 0;
+        pid_t r;
+        while ((r = waitpid(child, &status, WNOHANG)) == 0) {
+            if (now_secs() - t0 >= PROBE_TIMEOUT || atomic_load(&im->stop)) {
+                kill(-child, SIGKILL);
+                kill(child, SIGKILL);
+                while (waitpid(child, &status, 0) < 0 && errno == EINTR)
+                    ;
+                if (!atomic_load(&im->stop))
+                    im->probe_killed++;
+                r = -1;
+                break;
+            }
+            sleep_double(0.01);
+        }
+        double elapsed = now_secs() - t0;
+        if (r == child && WIFEXITED(status) && WEXITSTATUS(status) == 0)
+            series_push(&im->probe[ph], elapsed * 1000.0);
+
+        sleep_double(im->period - elapsed);
+    }
+    return NULL;
+}
+
+static void impact_start(impact_t *im, const target_t *t, const char *group_dir,
+                         const swapout_opts_t *o) {
+    memset(im, 0, sizeof(*im));
+    im->t = t;
+    im->group_dir = group_dir;
+    im->probe_cmd = o->probe_cmd;
+    im->period = o->impact_interval;
+    atomic_init(&im->phase, PHASE_DURING);
+    atomic_init(&im->stop, 0);
+
+    im->have_sampler = pthread_create(&im->sampler, NULL, impact_sampler, im) == 0;
+    if (im->probe_cmd)
+        im->have_prober = pthread_create(&im->prober, NULL, impact_prober, im) == 0;
+}
+
+/* Pageout done: keep sampling for the after-window, then stop */
+static void impact_finish(impact_t *im, double window) {
+    atomic_store(&im->phase, PHASE_AFTER);
+    if (im->t)
+        target_wait_exit(im->t, window);
+    else
+        sleep_double(window);
+    atomic_store(&im->stop, 1);
+    if (im->have_sampler)
+        pthread_join(im->sampler, NULL);
+    if (im->have_prober)
+        pthread_join(im->prober, NULL);
+}
+
+static void impact_report_row(const char *label, series_t *s) {
+    for (int ph = 0; ph < NPHASES; ph++) {
+        if (s[ph].n == 0)
+            continue;
+        qsort(s[ph].v, s[ph].n, sizeof(double), cmp_double);
+        printf("    %-20s %-7s %7zu %10.2f %10.2f %10.2f %10.2f\n",
+               label, phase_names[ph], s[ph].n,
+               series_pct(&s[ph], 50), series_pct(&s[ph], 90),
+               series_pct(&s[ph], 99), s[ph].v[s[ph].n - 1]);
+    }
+}
+
+static void impact_report(impact_t *im) {
+    printf("[+] Impact on target (per %.2f s sample):\n", im->period);
+    printf("    %-20s %-7s %7s %10s %10s %10s %10s\n",
+           "metric", "phase", "samples", "p50", "p90", "p99", "max");
+    impact_report_row("run delay (ms/s)", im->delay);
+    impact_report_row("major faults (/s)", im->majflt);
+    impact_report_row("memory PSI some (%)", im->psi);
+    impact_report_row("probe latency (ms)", im->probe);
+    if (im->probe_killed)
+        printf("    [!] %d probe(s) killed after %.0f s\n", im->probe_killed, PROBE_TIMEOUT);
+}
+
+static void impact_free(impact_t *im) {
+    for (int ph = 0; ph < NPHASES; ph++) {
+        free(im->delay[ph].v);
+        free(im->majflt[ph].v);
+        free(im->psi[ph].v);
+        free(im->probe[ph].v);
+    }
+}
+
+/* ---------- swapout driver ---------- */
+
+static const char *method_name(pageout_method_t m) {
+    switch (m) {
+    case METHOD_MADVISE: return "madvise";
+    case METHOD_COLD:    return "cold";
+    case METHOD_RECLAIM: return "reclaim";
+    default:             return "clamp";
+    }
+}
+
+/* Cgroup clamp: squeeze the target under a tiny limit until RSS drops */
+static int pageout_clamp(const target_t *t, const swapout_opts_t *o) {
+    int quiet = o->quiet;
+    pid_t pid = t->pid;
+
+    cgroup_ctx_t ctx;
+    if (setup_cgroup_for_pid(t, &ctx, quiet) != 0) {
+        fprintf(stderr, "Failed to set up cgroup for pid %d\n", pid);
+        release_cgroup(&ctx, t, quiet);
+        return 1;
+    }
+
+    if (apply_swap_tier(&ctx, o->tier, quiet) != 0 ||
+        apply_low_limit(&ctx, o->limit_mb, quiet) != 0) {
+        restore_limit(&ctx, quiet);
+        restore_knobs(&ctx, quiet);
+        release_cgroup(&ctx, t, quiet);
+        return 1;
+    }
+
+    /* Poll until RSS <= target_rss_kb or max_iter reached or process exits */
+    int iter = 0;
+    int done = 0;
+
+    if (!quiet)
+        printf("[+] Forcing swap... polling process memory usage\n");
+
+    while (iter < o->max_iter) {
+        proc_meminfo_t mi;
+        if (target_exited(t) || read_proc_meminfo(t, &mi) != 0) {
+            if (!quiet)
+                printf("[!] Process %d no longer exists, stopping.\n", pid);
+            done = 1;
+            break;
+        }
+
+        if (!quiet) {
+            printf("  iter %2d: RSS=%ld kB, SWAP=%ld kB\n",
+                   iter + 1, mi.rss_kb, mi.swap_kb);
+        }
+
+        if (mi.rss_kb <= o->target_rss_kb) {
+            if (!quiet)
+                printf("[+] Target RSS reached (<= %ld kB), stopping.\n", o->target_rss_kb);
+            done = 1;
+            break;
+        }
+
+        iter++;
+        target_wait_exit(t, o->interval);
+    }
+
+    if (!done && !quiet) {
+        printf("[!] max_iter reached without hitting target RSS; restoring anyway.\n");
+    }
+
+    if (o->tier != TIER_DEFAULT && !quiet)
+        report_swap_tier(&ctx);
+
+    restore_limit(&ctx, quiet);
+    restore_knobs(&ctx, quiet);
+    release_cgroup(&ctx, t, quiet);
+    return 0;
+}
+
+/*
+ * madvise: page out every VMA holding resident anonymous memory.
+ * THP-backed VMAs follow the --thp policy.
+ */
+static int pageout_madvise(int pidfd, const vma_list_t *vmas, const swapout_opts_t *o) {
+    wrange_list_t out = {0};
+    iov_list_t cold = {0};
+    int rc = 0;
+
+    for (size_t i = 0; i < vmas->n; i++) {
+        const vma_t *v = &vmas->v[i];
+        if (vma_pageable_kb(v) <= 0)
+            continue;
+        int r;
+        if (vma_is_thp(v) && o->thp == THP_SKIP)
+            continue;
+        if (vma_is_thp(v) && o->thp == THP_COLD)
+            r = iov_add(&cold, v->start, v->end);
+        else
+            r = wrange_add(&out, v->start, v->end, vma_pageable_kb(v));
+        if (r != 0) {
+            perror("iov_add");
+            rc = 1;
+            goto out;
+        }
+    }
+
+    int jobs = shard_jobs(&out, o->jobs);
+    if (!o->quiet)
+        printf("[+] Paging out %zu range(s), %ld kB resident anon/shmem, with process_madvise(MADV_PAGEOUT)"
+               " from %d thread(s)\n", out.n, out.total_kb, jobs);
+    long long paged = advise_sharded(pidfd, &out, MADV_PAGEOUT, jobs, o->quiet);
+    long long colded = paged < 0 ? -1 : advise_ranges(pidfd, cold.iov, cold.n, MADV_COLD, o->quiet);
+    if (paged < 0 || colded < 0) {
+        rc = 1;
+        goto out;
+    }
+    if (!o->quiet) {
+        printf("[+] MADV_PAGEOUT applied to %lld kB\n", paged / 1024);
+        if (cold.n)
+            printf("[+] MADV_COLD applied to %lld kB of THP-backed memory\n", colded / 1024);
+    }
+    if ((out.n > 0 || cold.n > 0) && paged + colded == 0) {
+        fprintf(stderr, "process_madvise accepted none of the %zu range(s)\n", out.n + cold.n);
+        rc = 1;
+    }
+
+out:
+    free_wranges(&out);
+    free_iovs(&cold);
+    return rc;
+}
+
+/*
+ * cold: move resident anonymous memory to the inactive LRU so it is the
+ * first to go under pressure, without writing anything to swap.
+ */
+static int deactivate_cold(int pidfd, const vma_list_t *vmas, const swapout_opts_t *o) {
+    iov_list_t cold = {0};
+    long resident_kb = 0;
+
+    for (size_t i = 0; i < vmas->n; i++) {
+        const vma_t *v = &vmas->v[i];
+        if (vma_pageable_kb(v) <= 0)
+            continue;
+        if (vma_is_thp(v) && o->thp == THP_SKIP)
+            continue;
+        if (iov_add(&cold, v->start, v->end) != 0) {
+            perror("iov_add");
+            free_iovs(&cold);
+            return 1;
+        }
+        resident_kb += vma_pageable_kb(v);
+    }
+
+    long long deact_before = read_vmstat("pgdeactivate");
+    long long inact_before = read_vmstat("nr_inactive_anon");
+    long long advised = advise_ranges(pidfd, cold.iov, cold.n, MADV_COLD, o->quiet);
+    long long deact_after = read_vmstat("pgdeactivate");
+    long long inact_after = read_vmstat("nr_inactive_anon");
+    size_t nranges = cold.n;
+    free_iovs(&cold);
+
+    if (advised < 0)
+        return 1;
+    if (nranges > 0 && advised == 0) {
+        fprintf(stderr, "process_madvise(MADV_COLD) accepted none of the %zu range(s)\n", nranges);
+        return 1;
+    }
+    if (!o->quiet) {
+        long kpp = sysconf(_SC_PAGESIZE) / 1024;
+        printf("[+] MADV_COLD accepted for %lld kB of address space (%ld kB resident in %zu range(s))\n",
+               advised / 1024, resident_kb, nranges);
+        /* MGLRU does not count pgdeactivate, so only show what moved */
+        if (deact_before >= 0 && deact_after > deact_before)
+            printf("[+] pgdeactivate: +%lld kB system-wide\n", (deact_after - deact_before) * kpp);
+        if (inact_before >= 0 && inact_after > inact_before)
+            printf("[+] Inactive anon: +%lld kB system-wide\n", (inact_after - inact_before) * kpp);
+    }
+    return 0;
+}
+
+/* Clamp helper pass: handle THP-backed VMAs before the cgroup squeeze */
+static void thp_prepass(int pidfd, const vma_list_t *vmas, const swapout_opts_t *o) {
+    int advice = (o->thp == THP_COLD) ? MADV_COLD : MADV_PAGEOUT;
+    iov_list_t thp = {0};
+
+    for (size_t i = 0; i < vmas->n; i++) {
+        if (vma_is_thp(&vmas->v[i]) &&
+            iov_add(&thp, vmas->v[i].start, vmas->v[i].end) != 0) {
+            free_iovs(&thp);
+            return;
+        }
+    }
+    if (thp.n) {
+        long long bytes = advise_ranges(pidfd, thp.iov, thp.n, advice, o->quiet);
+        if (bytes >= 0 && !o->quiet)
+            printf("[+] %s applied to %lld kB of THP-backed memory\n",
+                   advice_name(advice), bytes / 1024);
+    }
+    free_iovs(&thp);
+}
+
+/* ---------- NUMA node targeting (--node) ---------- */
+
+#define NUMA_MAX_NODES   64
+#define NODE_QUERY_BATCH 16384  /* pages per move_pages() query */
+
+static int numa_node_exists(int node) {
+    char path[64];
+    snprintf(path, sizeof(path), "/sys/devices/system/node/node%d", node);
+    return file_exists(path);
+}
+
+/*
+ * Sum resident kB per node from /proc/<pid>/numa_maps ("N<node>=<pages>",
+ * scaled by the mapping's kernelpagesize_kB).  Returns nodes seen, or -1.
+ */
+static int numa_resident(const target_t *t, long node_kb[NUMA_MAX_NODES]) {
+    FILE *fp = target_fopen(t, "numa_maps", "r");
+    if (!fp)
+        return -1;
+
+    memset(node_kb, 0, NUMA_MAX_NODES * sizeof(long));
+    int nodes = 0;
+    char line[4096];
+    while (fgets(line, sizeof(line), fp)) {
+        long pages[NUMA_MAX_NODES] = {0};
+        long psize_kb = 4;
+        int hi = -1;
+        char *save = NULL;
+        for (char *tok = strtok_r(line, " \n", &save); tok; tok = strtok_r(NULL, " \n", &save)) {
+            int node;
+            long n;
+            if (tok[0] == 'N' && sscanf(tok, "N%d=%ld", &node, &n) == 2 &&
+                node >= 0 && node < NUMA_MAX_NODES) {
+                pages[node] += n;
+                if (node > hi) hi = node;
+            } else if (strncmp(tok, "kernelpagesize_kB=", 18) == 0) {
+                psize_kb = strtol(tok + 18, NULL, 10);
+            }
+        }
+        for (int i = 0; i <= hi; i++)
+            node_kb[i] += pages[i] * psize_kb;
+        if (hi + 1 > nodes)
+            nodes = hi + 1;
+    }
+    fclose(fp);
+    return nodes;
+}
+
+static void report_numa(const target_t *t, const char *label) {
+    long node_kb[NUMA_MAX_NODES];
+    int nodes = numa_resident(t, node_kb);
+    if (nodes < 0) {
+        fprintf(stderr, "[!] Could not read /proc/%d/numa_maps\n", t->pid);
+        return;
+    }
+    printf("[+] NUMA %s:", label);
+    for (int i = 0; i < nodes; i++)
+        printf(" N%d=%ld kB", i, node_kb[i]);
+    proc_meminfo_t mi;
+    if (read_proc_meminfo(t, &mi) == 0)
+        printf(", swapped=%ld kB", mi.swap_kb);
+    printf("\n");
+}
+
+/*
+ * Collect the pages of anon and shmem VMAs that currently sit on `node`.
+ * move_pages() with a NULL node list only reports where each page lives;
+ * runs of consecutive pages on the node become one range.  With --thp cold,
+ * runs inside THP-backed VMAs go to `cold` instead of `out`.
+ */
+static int node_ranges(const target_t *t, const vma_list_t *vmas, int node,
+                       const swapout_opts_t *o, iov_list_t *out, iov_list_t *cold,
+                       long *node_kb) {
+    long psize = sysconf(_SC_PAGESIZE);
+    void **pages = malloc(NODE_QUERY_BATCH * sizeof(void *));
+    int *status = malloc(NODE_QUERY_BATCH * sizeof(int));
+    if (!pages || !status) {
+        free(pages);
+        free(status);
+        return -1;
+    }
+
+    int rc = 0;
+    *node_kb = 0;
+    for (size_t i = 0; i < vmas->n && rc == 0; i++) {
+        const vma_t *v = &vmas->v[i];
+        if (vma_pageable_kb(v) <= 0)
+            continue;
+        if (vma_is_thp(v) && o->thp == THP_SKIP)
+            continue;
+        iov_list_t *dst = (vma_is_thp(v) && o->thp == THP_COLD) ? cold : out;
+
+        unsigned long run_start = 0;
+        for (unsigned long addr = v->start; addr < v->end; ) {
+            unsigned long cnt = (v->end - addr) / (unsigned long)psize;
+            if (cnt > NODE_QUERY_BATCH) cnt = NODE_QUERY_BATCH;
+            for (unsigned long k = 0; k < cnt; k++)
+                pages[k] = (void *)(addr + k * (unsigned long)psize);
+
+            if (syscall(SYS_move_pages, t->pid, cnt, pages, NULL, status, 0) != 0) {
+                if (errno == ESRCH)
+                    rc = -1;
+                else if (!o->quiet)
+                    fprintf(stderr, "[!] move_pages query at 0x%lx: %s\n", addr, strerror(errno));
+                /* Unqueryable chunk: close any open run and move on */
+                if (run_start && iov_add(dst, run_start, addr) != 0)
+                    rc = -1;
+                run_start = 0;
+                addr += cnt * (unsigned long)psize;
+                if (rc != 0) break;
+                continue;
+            }
+
+            for (unsigned long k = 0; k < cnt; k++) {
+                unsigned long a = addr + k * (unsigned long)psize;
+                if (status[k] == node) {
+                    if (!run_start) run_start = a;
+                    *node_kb += psize / 1024;
+                } else if (run_start) {
+                    if (iov_add(dst, run_start, a) != 0) { rc = -1; break; }
+                    run_start = 0;
+                }
+            }
+            addr += cnt * (unsigned long)psize;
+        }
+        if (rc == 0 && run_start && iov_add(dst, run_start, v->end) != 0)
+            rc = -1;
+    }
+
+    free(pages);
+    free(status);
+    return rc;
+}
+
+/* --node: page out (or, with --method cold, deactivate) node-resident ranges only */
+static int pageout_node(const target_t *t, const vma_list_t *vmas, const swapout_opts_t *o) {
+    int advice = (o->method == METHOD_COLD) ? MADV_COLD : MADV_PAGEOUT;
+    iov_list_t ranges = {0};
+    iov_list_t cold = {0};
+    long node_kb = 0;
+
+    if (node_ranges(t, vmas, o->node, o, &ranges, &cold, &node_kb) != 0) {
+        fprintf(stderr, "Could not map pages of PID %d to NUMA nodes: %s\n",
+                t->pid, strerror(errno));
+        free_iovs(&ranges);
+        free_iovs(&cold);
+        return 1;
+    }
+
+    /* Every page in a node run is resident, so the range length is its weight */
+    wrange_list_t w = {0};
+    for (size_t i = 0; i < ranges.n; i++) {
+        unsigned long a = (unsigned long)ranges.iov[i].iov_base;
+        if (wrange_add(&w, a, a + ranges.iov[i].iov_len, (long)(ranges.iov[i].iov_len / 1024)) != 0) {
+            perror("wrange_add");
+            free_wranges(&w);
+            free_iovs(&ranges);
+            free_iovs(&cold);
+            return 1;
+        }
+    }
+
+    int jobs = advice == MADV_PAGEOUT ? shard_jobs(&w, o->jobs) : 1;
+    if (!o->quiet)
+        printf("[+] Node %d holds %ld kB of anon/shmem memory in %zu range(s); applying %s"
+               " from %d thread(s)\n", o->node, node_kb, ranges.n, advice_name(advice), jobs);
+    long long bytes = advise_sharded(t->pidfd, &w, advice, jobs, o->quiet);
+    free_wranges(&w);
+    if (bytes < 0) {
+        free_iovs(&ranges);
+        free_iovs(&cold);
+        return 1;
+    }
+    if (!o->quiet)
+        printf("[+] %s applied to %lld kB on node %d\n", advice_name(advice), bytes / 1024, o->node);
+    if (cold.n) {
+        long long colded = advise_ranges(t->pidfd, cold.iov, cold.n, MADV_COLD, o->quiet);
+        if (colded < 0) {
+            free_iovs(&ranges);
+            free_iovs(&cold);
+            return 1;
+        }
+        if (!o->quiet)
+            printf("[+] MADV_COLD applied to %lld kB of THP-backed memory on node %d\n",
+                   colded / 1024, o->node);
+    }
+
+    free_iovs(&ranges);
+    free_iovs(&cold);
+    return 0;
+}
+
+static void manifest_path(const swapout_opts_t *o, pid_t pid, char *out, size_t outsz) {
+    if (o->batch)
+        snprintf(out, outsz, "%s.%d", o->manifest, pid);
+    else
+        snprintf(out, outsz, "%s", o->manifest);
+}
+
+/* After pageout: record which ranges ended up in swap */
+static int save_manifest(const target_t *t, const vma_list_t *sampled, const swapout_opts_t *o) {
+    pid_t pid = t->pid;
+    char path[512];
+    manifest_path(o, pid, path, sizeof(path));
+
+    vma_list_t now = {0};
+    manifest_t m;
+    if (read_vmas(t, &now) != 0 || manifest_build(t, &now, sampled, &m) != 0) {
+        fprintf(stderr, "Failed to scan swapped ranges of pid %d: %s\n", pid, strerror(errno));
+        free_vmas(&now);
+        return 1;
+    }
+    free_vmas(&now);
+
+    int rc = 0;
+    if (manifest_write(path, &m) != 0) {
+        fprintf(stderr, "Failed to write manifest %s: %s\n", path, strerror(errno));
+        rc = 1;
+    } else if (!o->quiet) {
+        printf("[+] Manifest %s: %llu run(s), %llu kB swapped%s\n", path,
+               (unsigned long long)m.hdr.nruns,
+               (unsigned long long)(m.hdr.npages * m.hdr.page_size / 1024),
+               sampled ? ", access heat sampled" : "");
+    }
+    manifest_free(&m);
+    return rc;
+}
+
+/*
+ * --swapin: prefetch the ranges listed in the manifest (or, without one,
+ * whatever pagemap shows in swap right now) back into memory.
+ */
+static int swapin_one(pid_t pid, const swapout_opts_t *o) {
+    int quiet = o->quiet;
+    int jobs = o->jobs > 0 ? o->jobs : 4;
+    manifest_t m;
+
+    target_t t;
+    if (target_open(pid, &t) != 0) {
+        fprintf(stderr, "No such process: %d (%s)\n", pid, strerror(errno));
+        return 1;
+    }
+
+    if (o->manifest) {
+        char path[512];
+        manifest_path(o, pid, path, sizeof(path));
+        if (manifest_read(path, &m) != 0) {
+            fprintf(stderr, "Cannot load manifest %s: %s\n", path, strerror(errno));
+            target_close(&t);
+            return 1;
+        }
+        if (m.hdr.pid != pid || m.hdr.start_time != read_start_time(&t)) {
+            fprintf(stderr, "Manifest %s was recorded for a different process (pid %d)\n",
+                    path, m.hdr.pid);
+            manifest_free(&m);
+            target_close(&t);
+            return 1;
+        }
+    } else {
+        vma_list_t vmas = {0};
+        if (read_vmas(&t, &vmas) != 0 || manifest_build(&t, &vmas, NULL, &m) != 0) {
+            fprintf(stderr, "Failed to scan swapped ranges of pid %d: %s\n", pid, strerror(errno));
+            free_vmas(&vmas);
+            target_close(&t);
+            return 1;
+        }
+        free_vmas(&vmas);
+    }
+
+    manifest_order_t order = o->order;
+    if (order == ORDER_HOT && !(m.hdr.flags & MANIFEST_HEAT)) {
+        if (!quiet)
+            printf("[!] Manifest has no access heat; using swap order\n");
+        order = ORDER_SWAP;
+    }
+    manifest_sort(&m, order);
+
+    proc_meminfo_t before = {0}, after = {0};
+    read_proc_meminfo(&t, &before);
+    if (!quiet)
+        printf("[+] swapin: PID %d, %llu run(s), %llu kB, %d job(s)\n", pid,
+               (unsigned long long)m.hdr.nruns,
+               (unsigned long long)(m.hdr.npages * m.hdr.page_size / 1024), jobs);
+
+    double t0 = now_secs();
+    long long bytes = prefetch_manifest(&t, &m, jobs, quiet);
+    double elapsed = now_secs() - t0;
+    read_proc_meminfo(&t, &after);
+    target_close(&t);
+    manifest_free(&m);
+
+    if (bytes < 0) {
+        fprintf(stderr, "Prefetch failed for pid %d\n", pid);
+        return 1;
+    }
+    if (!quiet) {
+        printf("[+] Prefetched %lld kB in %.3f s (%.1f MB/s)\n", bytes / 1024, elapsed,
+               elapsed > 0 ? (double)bytes / (1024.0 * 1024.0) / elapsed : 0.0);
+        printf("[+] SWAP %ld kB -> %ld kB, RSS %ld kB -> %ld kB\n",
+               before.swap_kb, after.swap_kb, before.rss_kb, after.rss_kb);
+    }
+    return 0;
+}
+
+static int swapout_one(pid_t pid, const swapout_opts_t *o) {
+    int quiet = o->quiet;
+
+    /* Pin the process; everything below goes through the pidfd/procfd */
+    target_t t;
+    if (target_open(pid, &t) != 0) {
+        fprintf(stderr, "No such process: %d (%s)\n", pid, strerror(errno));
+        return 1;
+    }
+
+    if (!quiet) {
+        printf("[+] swapout: targeting PID %d (method %s)\n", pid,
+               method_name(o->method));
+        printf("[+] limit_mb=%ld, target_rss_kb=%ld, interval=%.2f, max_iter=%d\n",
+               o->limit_mb, o->target_rss_kb, o->interval, o->max_iter);
+    }
+
+    /* Access sampling: clear referenced bits, let the target run, then read them */
+    int sampled = 0;
+    if (o->manifest && o->sample_secs > 0) {
+        FILE *cr = target_fopen(&t, "clear_refs", "w");
+        if (cr && fputs("1\n", cr) >= 0 && fclose(cr) == 0) {
+            if (!quiet)
+                printf("[+] Sampling access bits for %.1f s\n", o->sample_secs);
+            target_wait_exit(&t, o->sample_secs);
+            sampled = 1;
+        } else if (!quiet) {
+            fprintf(stderr, "[!] Could not clear referenced bits: %s\n", strerror(errno));
+        }
+    }
+
+    vma_list_t vmas = {0};
+    if (read_vmas(&t, &vmas) != 0 && !quiet)
+        fprintf(stderr, "[!] Could not read /proc/%d/smaps\n", pid);
+    if (!quiet) {
+        report_thp(&vmas, "before", 1);
+        report_shmem(&vmas, "before");
+    }
+
+    impact_t im;
+    if (o->impact)
+        impact_start(&im, &t, NULL, o);
+
+    if (o->node >= 0 && !quiet)
+        report_numa(&t, "before");
+
+    int rc;
+    if (o->node >= 0) {
+        rc = pageout_node(&t, &vmas, o);
+    } else if (o->method == METHOD_MADVISE) {
+        rc = pageout_madvise(t.pidfd, &vmas, o);
+    } else if (o->method == METHOD_COLD) {
+        rc = deactivate_cold(t.pidfd, &vmas, o);
+    } else {
+        if (o->thp == THP_SPLIT || o->thp == THP_COLD)
+            thp_prepass(t.pidfd, &vmas, o);
+        rc = pageout_clamp(&t, o);
+    }
+
+    if (rc == 0 && o->manifest && !target_exited(&t))
+        rc = save_manifest(&t, sampled ? &vmas : NULL, o);
+    free_vmas(&vmas);
+
+    if (o->impact) {
+        impact_finish(&im, o->impact_window);
+        if (!quiet)
+            impact_report(&im);
+        impact_free(&im);
+    }
+
+    if (!quiet) {
+        proc_meminfo_t mi;
+        if (read_proc_meminfo(&t, &mi) == 0)
+            printf("[+] After: RSS=%ld kB, SWAP=%ld kB\n", mi.rss_kb, mi.swap_kb);
+        if (o->node >= 0)
+            report_numa(&t, "after");
+        if (read_vmas(&t, &vmas) == 0) {
+            report_thp(&vmas, "after", 0);
+            report_shmem(&vmas, "after");
+            free_vmas(&vmas);
+        }
+    }
+
+    target_close(&t);
+
+    if (!quiet && rc == 0)
+        printf("[+] swapout complete.\n");
+
+    return rc;
+}
+
+/* ---------- park / unpark ---------- */
+
+/*
+ * --park moves the target into a pool worker, freezes that group (v2
+ * cgroup.freeze, v1 freezer controller), pages everything out and writes a
+ * manifest that remembers the original cgroup.  The process stays frozen in
+ * the worker; the worker is not reused while it is occupied.
+ *
+ * --unpark prefetches the manifest while the process is still frozen, then
+ * thaws it and moves it back, so it resumes with its memory already in.
+ */
+#define FREEZER_MOUNT     "/sys/fs/cgroup/freezer"
+#define FREEZE_TIMEOUT    10.0      /* seconds to wait for (un)freeze to settle */
+#define PORT_POLL_SECS    0.05
+
+/* The interface file that freezes a group; also its journal key */
+static void freeze_file(cgroup_version_t ver, const char *dir, char *out, size_t outsz) {
+    snprintf(out, outsz, "%s/%s", dir, ver == CGROUP_V2 ? "cgroup.freeze" : "freezer.state");
+}
+
+/*
+ * Freeze or thaw a group and wait until the kernel reports it done.  A
+ * freeze is journaled as its thaw; a thaw clears that entry.
+ */
+static int group_freeze(cgroup_version_t ver, const char *dir, const target_t *t, int freeze) {
+    char path[PATH_MAX + 32], ctl[PATH_MAX + 32];
+    const char *thaw = (ver == CGROUP_V2) ? "0" : "THAWED";
+    freeze_file(ver, dir, ctl, sizeof(ctl));
+    if (freeze && journal_record(ctl, thaw, NULL) != 0)
+        return -1;
+    int rc = (ver == CGROUP_V2) ? write_file(ctl, freeze ? "1\n" : "0\n")
+                                : write_file(ctl, freeze ? "FROZEN\n" : "THAWED\n");
+    if (!freeze && rc == 0)
+        journal_clear(ctl);
+    if (rc != 0)
+        return -1;
+    if (ver == CGROUP_V2)
+        snprintf(path, sizeof(path), "%s/cgroup.events", dir);
+    else
+        snprintf(path, sizeof(path), "%s/freezer.state", dir);
+
+    const char *want = (ver == CGROUP_V2) ? (freeze ? "frozen 1" : "frozen 0")
+                                          : (freeze ? "FROZEN" : "THAWED");
+    double deadline = now_secs() + FREEZE_TIMEOUT;
+    while (now_secs() < deadline) {
+        char *state = read_file(path);
+        int done = state && strstr(state, want) != NULL;
+        free(state);
+        if (done)
+            return 0;
+        if (target_wait_exit(t, 0.01)) {
+            errno = ESRCH;
+            return -1;
+        }
+    }
+    errno = ETIMEDOUT;
+    return -1;
+}
+
+/*
+ * v1: the freezer is a separate hierarchy; mirror the worker there.  The
+ * move is journaled as the move back to orig_fz.
+ */
+static int freezer_join(const cgroup_ctx_t *ctx, const target_t *t, const char *orig_fz,
+                        char *dir, size_t dirsz) {
+    if (ensure_dir(FREEZER_MOUNT "/swapout") != 0)
+        return -1;
+    snprintf(dir, dirsz, FREEZER_MOUNT "/swapout/worker-%03d", ctx->worker);
+    if (ensure_dir(dir) != 0)
+        return -1;
+
+    char procs[PATH_MAX + 32], back[PATH_MAX + 32], pidbuf[32];
+    snprintf(procs, sizeof(procs), "%s/cgroup.procs", dir);
+    cgroup_procs_path(FREEZER_MOUNT, orig_fz, back, sizeof(back));
+    snprintf(pidbuf, sizeof(pidbuf), "%d", t->pid);
+    if (journal_record(back, pidbuf, t) != 0)
+        return -1;
+    if (write_file(procs, strcat(pidbuf, "\n")) != 0) {
+        int saved = errno;
+        journal_clear(back);
+        errno = saved;
+        return -1;
+    }
+    return 0;
+}
+
+/* Move the target into <mount><rel> (rel "/" is the root) */
+static int move_to_cgroup(const char *mount, const char *rel, pid_t pid) {
+    char path[PATH_MAX + 32], pidbuf[32];
+    cgroup_procs_path(mount, rel, path, sizeof(path));
+    snprintf(pidbuf, sizeof(pidbuf), "%d\n", pid);
+    return write_file(path, pidbuf);
+}
+
+static int park_one(pid_t pid, const swapout_opts_t *o) {
+    int quiet = o->quiet;
+    char path[512];
+    manifest_path(o, pid, path, sizeof(path));
+
+    target_t t;
+    if (target_open(pid, &t) != 0) {
+        fprintf(stderr, "No such process: %d (%s)\n", pid, strerror(errno));
+        return 1;
+    }
+
+    manifest_t m;
+    memset(&m, 0, sizeof(m));
+    cgroup_ctx_t ctx;
+    char fz_dir[PATH_MAX] = "";
+    char orig_fz[256] = "";
+    int rc = 1;
+
+    if (setup_cgroup_for_pid(&t, &ctx, quiet) != 0)
+        goto fail;
+
+    const char *freeze_dir = ctx.group_dir;
+    if (ctx.ver == CGROUP_V1) {
+        if (read_proc_cgroup_ctrl(&t, "freezer", orig_fz, sizeof(orig_fz)) != 0 ||
+            freezer_join(&ctx, &t, orig_fz, fz_dir, sizeof(fz_dir)) != 0) {
+            fprintf(stderr, "No usable v1 freezer for pid %d: %s\n", pid, strerror(errno));
+            goto fail;
+        }
+        freeze_dir = fz_dir;
+    }
+
+    double t0 = now_secs();
+    if (group_freeze(ctx.ver, freeze_dir, &t, 1) != 0) {
+        fprintf(stderr, "Failed to freeze %s: %s\n", freeze_dir, strerror(errno));
+        group_freeze(ctx.ver, freeze_dir, &t, 0);
+        goto fail;
+    }
+    if (!quiet)
+        printf("[+] Frozen %s in %.3f s\n", freeze_dir, now_secs() - t0);
+
+    /* Pageout, then rescan: the manifest lists what actually reached swap */
+    vma_list_t vmas = {0};
+    int ok = read_vmas(&t, &vmas) == 0 && pageout_madvise(t.pidfd, &vmas, o) == 0;
+    free_vmas(&vmas);
+    if (!ok || read_vmas(&t, &vmas) != 0 || manifest_build(&t, &vmas, NULL, &m) != 0) {
+        fprintf(stderr, "Pageout of pid %d failed: %s\n", pid, strerror(errno));
+        free_vmas(&vmas);
+        group_freeze(ctx.ver, freeze_dir, &t, 0);
+        goto fail;
+    }
+    free_vmas(&vmas);
+
+    snprintf(m.park.origin, sizeof(m.park.origin), "%s", ctx.orig_cgroup);
+    snprintf(m.park.origin_freezer, sizeof(m.park.origin_freezer), "%s", orig_fz);
+    m.hdr.flags |= MANIFEST_PARKED;
+
+    if (manifest_write(path, &m) != 0) {
+        fprintf(stderr, "Failed to write manifest %s: %s\n", path, strerror(errno));
+        group_freeze(ctx.ver, freeze_dir, &t, 0);
+        goto fail;
+    }
+
+    proc_meminfo_t mi = {0};
+    read_proc_meminfo(&t, &mi);
+    if (!quiet)
+        printf("[+] Parked PID %d in %s: RSS=%ld kB, SWAP=%ld kB, manifest %s (%llu run(s))\n",
+               pid, ctx.group_dir, mi.rss_kb, mi.swap_kb, path,
+               (unsigned long long)m.hdr.nruns);
+
+    /*
+     * Leave it frozen in the worker; an occupied worker is never handed
+     * out.  From here on the manifest, not the journal, records the way back.
+     */
+    char ctl[PATH_MAX + 32];
+    freeze_file(ctx.ver, freeze_dir, ctl, sizeof(ctl));
+    journal_clear(ctl);
+    ctx.moved = 0;
+    rc = 0;
+
+fail:
+    if (fz_dir[0] && orig_fz[0]) {
+        char back[PATH_MAX + 32];
+        if (rc != 0)
+            move_to_cgroup(FREEZER_MOUNT, orig_fz, pid);
+        cgroup_procs_path(FREEZER_MOUNT, orig_fz, back, sizeof(back));
+        journal_clear(back);
+    }
+    release_cgroup(&ctx, &t, quiet || rc == 0);
+    manifest_free(&m);
+    target_close(&t);
+    return rc;
+}
+
+/*
+ * Is any of 'ports' a listening TCP socket in the target's network
+ * namespace with connections waiting in its accept queue?  For LISTEN
+ * sockets (state 0A) rx_queue is the accept backlog.  Returns the port.
+ */
+static int port_pending(const target_t *t, const int *ports, int nports) {
+    const char *files[] = { "net/tcp", "net/tcp6" };
+    for (size_t f = 0; f < sizeof(files) / sizeof(files[0]); f++) {
+        FILE *fp = target_fopen(t, files[f], "r");
+        if (!fp)
+            continue;
+        char line[512];
+        while (fgets(line, sizeof(line), fp)) {
+            unsigned int lport, state, txq, rxq;
+            if (sscanf(line, " %*d: %*[0-9A-Fa-f]:%x %*[0-9A-Fa-f]:%*x %x %x:%x",
+                       &lport, &state, &txq, &rxq) != 4 || state != 0x0A || rxq == 0)
+                continue;
+            for (int i = 0; i < nports; i++) {
+                if ((unsigned int)ports[i] == lport) {
+                    fclose(fp);
+                    return ports[i];
+                }
+            }
+        }
+        fclose(fp);
+    }
+    return 0;
+}
+
+static int unpark_one(pid_t pid, const swapout_opts_t *o) {
+    int quiet = o->quiet;
+    int jobs = o->jobs > 0 ? o->jobs : 4;
+    char path[512];
+    manifest_path(o, pid, path, sizeof(path));
+
+    target_t t;
+    if (target_open(pid, &t) != 0) {
+        fprintf(stderr, "No such process: %d (%s)\n", pid, strerror(errno));
+        return 1;
+    }
+
+    manifest_t m;
+    if (manifest_read(path, &m) != 0) {
+        fprintf(stderr, "Cannot load manifest %s: %s\n", path, strerror(errno));
+        target_close(&t);
+        return 1;
+    }
+    if (!(m.hdr.flags & MANIFEST_PARKED) || m.hdr.pid != pid ||
+        m.hdr.start_time != read_start_time(&t)) {
+        fprintf(stderr, "Manifest %s is not a park record for pid %d\n", path, pid);
+        manifest_free(&m);
+        target_close(&t);
+        return 1;
+    }
+
+    cgroup_version_t ver = detect_cgroup_version();
+    char cur[256], group_dir[PATH_MAX], freeze_dir[PATH_MAX];
+    if (read_proc_cgroup(&t, ver, cur, sizeof(cur)) != 0) {
+        fprintf(stderr, "Could not determine current cgroup of pid %d\n", pid);
+        manifest_free(&m);
+        target_close(&t);
+        return 1;
+    }
+    snprintf(group_dir, sizeof(group_dir), "%s%s", cgroup_mount(ver), cur);
+    snprintf(freeze_dir, sizeof(freeze_dir), "%s", group_dir);
+    if (ver == CGROUP_V1 && read_proc_cgroup_ctrl(&t, "freezer", cur, sizeof(cur)) == 0)
+        snprintf(freeze_dir, sizeof(freeze_dir), FREEZER_MOUNT "%s", cur);
+
+    if (o->nwait_ports > 0) {
+        if (!quiet)
+            printf("[+] Waiting for a connection on %d port(s) of PID %d\n", o->nwait_ports, pid);
+        int port = 0;
+        while (!(port = port_pending(&t, o->wait_ports, o->nwait_ports))) {
+            if (target_wait_exit(&t, PORT_POLL_SECS)) {
+                fprintf(stderr, "Process %d exited while parked\n", pid);
+                manifest_free(&m);
+                target_close(&t);
+                return 1;
+            }
+        }
+        if (!quiet)
+            printf("[+] Connection pending on port %d, unparking\n", port);
+    }
+
+    /* Latency is measured from here: the moment a wake-up was asked for */
+    double t0 = now_secs();
+    manifest_sort(&m, o->order == ORDER_ADDR ? ORDER_ADDR : ORDER_SWAP);
+    long long bytes = prefetch_manifest(&t, &m, jobs, quiet);
+    double t_fetch = now_secs();
+
+    int rc = 0;
+    if (group_freeze(ver, freeze_dir, &t, 0) != 0) {
+        fprintf(stderr, "Failed to thaw %s: %s\n", freeze_dir, strerror(errno));
+        rc = 1;
+    }
+    double t_thaw = now_secs();
+
+    if (move_to_cgroup(cgroup_mount(ver), m.park.origin, pid) != 0 ||
+        (ver == CGROUP_V1 && m.park.origin_freezer[0] &&
+         move_to_cgroup(FREEZER_MOUNT, m.park.origin_freezer, pid) != 0)) {
+        fprintf(stderr, "[!] Could not return pid %d to %s: %s\n", pid, m.park.origin, strerror(errno));
+    } else if (!quiet) {
+        printf("[+] Returned PID %d to %s\n", pid, m.park.origin);
+    }
+
+    if (!quiet) {
+        proc_meminfo_t mi = {0};
+        read_proc_meminfo(&t, &mi);
+        printf("[+] Unparked PID %d in %.3f s: prefetch %.3f s (%lld kB, %d job(s)), thaw %.3f s\n",
+               pid, t_thaw - t0, t_fetch - t0, bytes > 0 ? bytes / 1024 : 0, jobs,
+               t_thaw - t_fetch);
+        printf("[+] After: RSS=%ld kB, SWAP=%ld kB\n", mi.rss_kb, mi.swap_kb);
+    }
+
+    if (rc == 0)
+        unlink(path);
+    manifest_free(&m);
+    target_close(&t);
+    return rc;
+}
+
+/* ---------- in-place cgroup reclaim (--cgroup / --unit) ---------- */
+
+static char unit_name[256];
+static char unit_found[PATH_MAX];
+
+static int unit_match(const char *path, const struct stat *st, int flag, struct FTW *ftw) {
+    (void)st;
+    if (flag != FTW_D)
+        return 0;
+    if (strcmp(path + ftw->base, unit_name) == 0) {
+        snprintf(unit_found, sizeof(unit_found), "%s", path);
+        return 1;
+    }
+    return 0;
+}
+
+/* Find the cgroup directory systemd created for a unit (e.g. foo.service) */
+static int resolve_unit(cgroup_version_t ver, const char *unit, char *out, size_t outsz) {
+    snprintf(unit_name, sizeof(unit_name), "%s", unit);
+    unit_found[0] = '\0';
+    if (nftw(cgroup_mount(ver), unit_match, 32, FTW_PHYS) != 1)
+        return -1;
+    snprintf(out, outsz, "%s", unit_found);
+    return 0;
+}
+
+/* Charged memory and swap of a group in kB */
+static int group_usage(const char *dir, cgroup_version_t ver, long *mem_kb, long *swap_kb) {
+    char path[PATH_MAX + 32];
+    char *val;
+
+    snprintf(path, sizeof(path), "%s/%s", dir,
+             ver == CGROUP_V2 ? "memory.current" : "memory.usage_in_bytes");
+    if (!(val = read_file(path)))
+        return -1;
+    long long mem = atoll(val);
+    free(val);
+
+    long long swap = 0;
+    if (ver == CGROUP_V2) {
+        snprintf(path, sizeof(path), "%s/memory.swap.current", dir);
+        if ((val = read_file(path))) {
+            swap = atoll(val);
+            free(val);
+        }
+    } else {
+        /* v1 only knows memory+swap combined */
+        snprintf(path, sizeof(path), "%s/memory.memsw.usage_in_bytes", dir);
+        if ((val = read_file(path))) {
+            swap = atoll(val) - mem;
+            free(val);
+        }
+    }
+    *mem_kb = (long)(mem / 1024);
+    *swap_kb = (long)((swap > 0 ? swap : 0) / 1024);
+    return 0;
+}
+
+/* memory.reclaim: ask the kernel for exactly the excess, repeat until met */
+static int group_reclaim(const char *dir, const swapout_opts_t *o) {
+    char path[PATH_MAX + 32];
+    snprintf(path, sizeof(path), "%s/memory.reclaim", dir);
+    if (!file_exists(path)) {
+        fprintf(stderr, "%s not available (cgroup v2, Linux 5.19+)\n", path);
+        return 1;
+    }
+
+    for (int iter = 0; iter < o->max_iter; iter++) {
+        long mem_kb, swap_kb;
+        if (group_usage(dir, CGROUP_V2, &mem_kb, &swap_kb) != 0)
+            return 1;
+        if (!o->quiet)
+            printf("  iter %2d: MEM=%ld kB, SWAP=%ld kB\n", iter + 1, mem_kb, swap_kb);
+        if (mem_kb <= o->target_rss_kb) {
+            if (!o->quiet)
+                printf("[+] Target reached (<= %ld kB), stopping.\n", o->target_rss_kb);
+            return 0;
+        }
+
+        char req[32];
+        snprintf(req, sizeof(req), "%lldK\n", (long long)(mem_kb - o->target_rss_kb));
+        if (write_file(path, req) != 0) {
+            if (errno != EAGAIN) {
+                fprintf(stderr, "Write to %s failed: %s\n", path, strerror(errno));
+                return 1;
+            }
+            /* Partial reclaim: back off before asking again */
+            sleep_double(o->interval);
+        }
+    }
+    if (!o->quiet)
+        printf("[!] max_iter reached without hitting target usage.\n");
+    return 0;
+}
+
+/* Clamp the group's own limit, wait for usage to fall, put the limit back */
+static int group_clamp(const char *dir, cgroup_version_t ver, const swapout_opts_t *o) {
+    cgroup_ctx_t ctx;
+    memset(&ctx, 0, sizeof(ctx));
+    ctx.ver = ver;
+    ctx.worker = -1;
+    ctx.lock_fd = -1;
+    snprintf(ctx.group_dir, sizeof(ctx.group_dir), "%s", dir);
+    snprintf(ctx.limit_path, sizeof(ctx.limit_path), "%s/%s", dir,
+             ver == CGROUP_V2 ? "memory.high" : "memory.limit_in_bytes");
+
+    char *orig = read_file(ctx.limit_path);
+    if (!orig) {
+        fprintf(stderr, "Cannot read %s: %s\n", ctx.limit_path, strerror(errno));
+        return 1;
+    }
+    rtrim(orig);
+    snprintf(ctx.backup_limit, sizeof(ctx.backup_limit), "%s", orig);
+    ctx.had_backup = 1;
+    free(orig);
+    if (!o->quiet)
+        printf("[+] Original limit at %s: '%s'\n", ctx.limit_path, ctx.backup_limit);
+
+    if (apply_low_limit(&ctx, o->limit_mb, o->quiet) != 0) {
+        restore_limit(&ctx, o->quiet);
+        return 1;
+    }
+
+    int iter;
+    for (iter = 0; iter < o->max_iter; iter++) {
+        long mem_kb, swap_kb;
+        if (group_usage(dir, ver, &mem_kb, &swap_kb) != 0)
+            break;
+        if (!o->quiet)
+            printf("  iter %2d: MEM=%ld kB, SWAP=%ld kB\n", iter + 1, mem_kb, swap_kb);
+        if (mem_kb <= o->target_rss_kb) {
+            if (!o->quiet)
+                printf("[+] Target reached (<= %ld kB), stopping.\n", o->target_rss_kb);
+            break;
+        }
+        sleep_double(o->interval);
+    }
+    if (iter == o->max_iter && !o->quiet)
+        printf("[!] max_iter reached without hitting target usage; restoring anyway.\n");
+
+    restore_limit(&ctx, o->quiet);
+    return 0;
+}
+
+/*
+ * Reclaim an existing cgroup where it is.  Member processes are never
+ * migrated: either memory.reclaim is asked for the excess, or the group's
+ * own limit is lowered temporarily and restored.
+ */
+static int swapout_group(const char *dir, const swapout_opts_t *o) {
+    cgroup_version_t ver = detect_cgroup_version();
+    long mem_before, swap_before, mem_after, swap_after;
+
+    if (group_usage(dir, ver, &mem_before, &swap_before) != 0) {
+        fprintf(stderr, "%s is not a cgroup with the memory controller enabled\n", dir);
+        return 1;
+    }
+    if (o->method == METHOD_RECLAIM && ver != CGROUP_V2) {
+        fprintf(stderr, "--method reclaim needs cgroup v2 (memory.reclaim)\n");
+        return 1;
+    }
+    if (journal_open() != 0) {
+        fprintf(stderr, "Cannot set up journal in %s: %s\n", POOL_RUN_DIR, strerror(errno));
+        return 1;
+    }
+    if (!o->quiet) {
+        printf("[+] swapout: reclaiming cgroup %s in place (method %s)\n",
+               dir, method_name(o->method));
+        printf("[+] Before: MEM=%ld kB, SWAP=%ld kB\n", mem_before, swap_before);
+    }
+
+    /* --tier steers the group's own zswap knobs for the duration of the run */
+    cgroup_ctx_t tier_ctx;
+    memset(&tier_ctx, 0, sizeof(tier_ctx));
+    tier_ctx.ver = ver;
+    tier_ctx.worker = -1;
+    tier_ctx.lock_fd = -1;
+    snprintf(tier_ctx.group_dir, sizeof(tier_ctx.group_dir), "%s", dir);
+    if (apply_swap_tier(&tier_ctx, o->tier, o->quiet) != 0) {
+        restore_knobs(&tier_ctx, o->quiet);
+        return 1;
+    }
+
+    impact_t im;
+    if (o->impact)
+        impact_start(&im, NULL, dir, o);
+
+    int rc = (o->method == METHOD_RECLAIM) ? group_reclaim(dir, o)
+                                           : group_clamp(dir, ver, o);
+
+    if (o->tier != TIER_DEFAULT && !o->quiet)
+        report_swap_tier(&tier_ctx);
+    restore_knobs(&tier_ctx, o->quiet);
+
+    if (o->impact) {
+        impact_finish(&im, o->impact_window);
+        if (!o->quiet)
+            impact_report(&im);
+        impact_free(&im);
+    }
+
+    if (!o->quiet && group_usage(dir, ver, &mem_after, &swap_after) == 0) {
+        printf("[+] After: MEM=%ld kB, SWAP=%ld kB\n", mem_after, swap_after);
+        if (rc == 0)
+            printf("[+] swapout complete.\n");
+    }
+    return rc;
+}
+
+/* ---------- tmpfs pageout (--tmpfs DIR) ---------- */
+
+#define TMPFS_MAGIC_ID  0x01021994
+#define TMPFS_WINDOW    (1UL << 30)   /* map files 1 GB at a time */
+
+typedef struct {
+    long files;
+    long resident_kb;
+    long long advised;
+    long errors;
+} tmpfs_stats_t;
+
+static tmpfs_stats_t tmpfs_st;
+
+/*
+ * MADV_PAGEOUT only reaches pages mapped in our page tables, so map each
+ * window, use mincore() to find the resident pages, fault just those in
+ * with a read (swapped pages stay swapped) and page the window out.
+ */
+static int tmpfs_pageout_file(const char *path, const struct stat *st, int flag,
+                              struct FTW *ftw) {
+    (void)ftw;
+    if (flag != FTW_F || !S_ISREG(st->st_mode) || st->st_size == 0)
+        return 0;
+
+    int fd = open(path, O_RDONLY | O_CLOEXEC | O_NOFOLLOW);
+    if (fd < 0) {
+        tmpfs_st.errors++;
+        return 0;
+    }
+    tmpfs_st.files++;
+
+    long psize = sysconf(_SC_PAGESIZE);
+    unsigned char *vec = malloc(TMPFS_WINDOW / (unsigned long)psize);
+    for (off_t off = 0; vec && off < st->st_size; off += (off_t)TMPFS_WINDOW) {
+        size_t len = (size_t)(st->st_size - off);
+        if (len > TMPFS_WINDOW) len = TMPFS_WINDOW;
+
+        char *map = mmap(NULL, len, PROT_READ, MAP_SHARED, fd, off);
+        if (map == MAP_FAILED) {
+            tmpfs_st.errors++;
+            break;
+        }
+        size_t pages = (len + (size_t)psize - 1) / (size_t)psize;
+        if (mincore(map, len, vec) == 0) {
+            for (size_t i = 0; i < pages; i++) {
+                if (vec[i] & 1) {
+                    (void)*(volatile char *)(map + i * (size_t)psize);
+                    tmpfs_st.resident_kb += psize / 1024;
+                }
+            }
+            if (madvise(map, len, MADV_PAGEOUT) == 0)
+                tmpfs_st.advised += (long long)len;
+            else
+                tmpfs_st.errors++;
+        }
+        munmap(map, len);
+    }
+    free(vec);
+    close(fd);
+    return 0;
+}
+
+/*
+ * Page out every file under a tmpfs mount.  The work is done by a child
+ * parked in a pool worker group, so nothing it touches is charged to (or
+ * reclaimed from) swapout's own cgroup.
+ */
+static int swapout_tmpfs(const char *dir, const swapout_opts_t *o) {
+    struct statfs sfs;
+    if (statfs(dir, &sfs) != 0) {
+        fprintf(stderr, "statfs %s: %s\n", dir, strerror(errno));
+        return 1;
+    }
+    if ((unsigned long)sfs.f_type != TMPFS_MAGIC_ID) {
+        fprintf(stderr, "%s is not on tmpfs\n", dir);
+        return 1;
+    }
+
+    cgroup_ctx_t ctx;
+    memset(&ctx, 0, sizeof(ctx));
+    ctx.worker = -1;
+    ctx.lock_fd = -1;
+    ctx.ver = detect_cgroup_version();
+    if (ctx.ver != CGROUP_NONE && pool_acquire(&ctx, o->quiet) != 0)
+        return 1;
+
+    long shmem_before = read_sys_meminfo_kb("Shmem");
+    long long out_before = read_vmstat("pswpout");
+    if (!o->quiet)
+        printf("[+] swapout: tmpfs %s, system Shmem=%ld kB\n", dir, shmem_before);
+
+    fflush(stdout);
+    fflush(stderr);
+    pid_t child = fork();
+    if (child < 0) {
+        fprintf(stderr, "fork: %s\n", strerror(errno));
+        pool_release(&ctx);
+        return 1;
+    }
+    if (child == 0) {
+        if (ctx.group_dir[0]) {
+            char procs[PATH_MAX + 32], pidbuf[32];
+            snprintf(procs, sizeof(procs), "%s/cgroup.procs", ctx.group_dir);
+            snprintf(pidbuf, sizeof(pidbuf), "%d\n", getpid());
+            if (write_file(procs, pidbuf) != 0 && !o->quiet)
+                printf("[!] Could not join %s: %s\n", ctx.group_dir, strerror(errno));
+            else if (!o->quiet)
+                printf("[+] Pageout helper %d running in %s\n", getpid(), ctx.group_dir);
+        }
+        if (nftw(dir, tmpfs_pageout_file, 32, FTW_PHYS | FTW_MOUNT) != 0) {
+            fprintf(stderr, "walk %s: %s\n", dir, strerror(errno));
+            fflush(stdout);
+            _exit(1);
+        }
+        if (!o->quiet)
+            printf("[+] tmpfs: %ld file(s), %ld kB resident, MADV_PAGEOUT applied to %lld kB"
+                   "%s\n", tmpfs_st.files, tmpfs_st.resident_kb, tmpfs_st.advised / 1024,
+                   tmpfs_st.errors ? " (some files or windows failed)" : "");
+        fflush(stdout);
+        _exit(0);
+    }
+
+    int status = 0;
+    while (waitpid(child, &status, 0) < 0 && errno == EINTR)
+        ;
+    pool_release(&ctx);
+
+    long shmem_after = read_sys_meminfo_kb("Shmem");
+    long long out_after = read_vmstat("pswpout");
+    if (!o->quiet) {
+        printf("[+] After: system Shmem=%ld kB (%+ld kB)", shmem_after, shmem_after - shmem_before);
+        if (out_before >= 0 && out_after >= out_before)
+            printf(", swapped out %lld kB", (out_after - out_before) * (sysconf(_SC_PAGESIZE) / 1024));
+        printf("\n");
+    }
+
+    int rc = (WIFEXITED(status) && WEXITSTATUS(status) == 0) ? 0 : 1;
+    if (!o->quiet && rc == 0)
+        printf("[+] swapout complete.\n");
+    return rc;
+}
+
+static int run_target(pid_t pid, const swapout_opts_t *o) {
+    if (journal_open() != 0) {
+        fprintf(stderr, "Cannot set up journal in %s: %s\n", POOL_RUN_DIR, strerror(errno));
+        return 1;
+    }
+    if (o->park)
+        return park_one(pid, o);
+    if (o->unpark)
+        return unpark_one(pid, o);
+    return o->swapin ? swapin_one(pid, o) : swapout_one(pid, o);
+}
+
+/* Fork one child per target, keeping at most 'parallel' of them running */
+static int run_batch(const pid_t *pids, int npids, int parallel, const swapout_opts_t *o) {
+    int running = 0;
+    int next = 0;
+    int failed = 0;
+
+    while (next < npids || running > 0) {
+        while (running < parallel && next < npids) {
+            fflush(stdout);
+            fflush(stderr);
+            pid_t child = fork();
+            if (child < 0) {
+                fprintf(stderr, "fork for pid %d: %s\n", pids[next], strerror(errno));
+                failed++;
+                next++;
+                continue;
+            }
+            if (child == 0)
+                _exit(run_target(pids[next], o));
+            running++;
+            next++;
+        }
+        if (running == 0)
+            break;
+
+        int status;
+        if (wait(&status) < 0) {
+            if (errno == EINTR)
+                continue;
+            break;
+        }
+        running--;
+        if (!WIFEXITED(status) || WEXITSTATUS(status) != 0)
+            failed++;
+    }
+
+    if (!o->quiet)
+        printf("[+] batch: %d targets, %d ok, %d failed\n",
+               npids, npids - failed, failed);
+    return failed ? 1 : 0;
 }
 
 /* ---------- main ---------- */
 
+enum {
+    OPT_POOL_IDLE = 256,
+    OPT_GC,
+    OPT_THP,
+    OPT_COLD,
+    OPT_TIER,
+    OPT_MANIFEST,
+    OPT_SWAPIN,
+    OPT_ORDER,
+    OPT_SAMPLE,
+    OPT_CGROUP,
+    OPT_UNIT,
+    OPT_IMPACT,
+    OPT_IMPACT_INTERVAL,
+    OPT_PROBE,
+    OPT_NODE,
+    OPT_TMPFS,
+    OPT_PARK,
+    OPT_UNPARK,
+    OPT_WAIT_PORT,
+    OPT_RECOVER
+};
+
 int main(int argc, char **argv) {
-    long limit_mb = 8;          /* memory limit during swapout */
-    long target_rss_kb = 16384; /* stop when RSS <= this (default 16MB) */
-    double interval = 1.0;      /* seconds between polls */
-    int max_iter = 60;          /* maximum iterations */
-    int quiet = 0;
+    swapout_opts_t o = {
+        .method        = METHOD_CLAMP,
+        .thp           = THP_DEFAULT,
+        .tier          = TIER_DEFAULT,
+        .limit_mb      = 8,       /* memory limit during swapout */
+        .target_rss_kb = 16384,   /* stop when RSS <= this (default 16MB) */
+        .interval      = 1.0,     /* seconds between polls */
+        .max_iter      = 60,      /* maximum iterations */
+        .quiet         = 0,
+        .order         = ORDER_SWAP,
+        .jobs          = 0,       /* swapin: 4 threads, pageout: 1 */
+        .impact_interval = 0.25,
+        .node          = -1,
+    };
+    int parallel = 4;
+    long pool_idle = POOL_IDLE_SECS;
+    int gc_only = 0;
+    int recover = 0;
+    const char *cgroup_arg = NULL;
+    const char *unit_arg = NULL;
+    const char *tmpfs_arg = NULL;
 
     static struct option long_opts[] = {
         {"limit-mb",       required_argument, 0, 'm'},
         {"target-rss-kb",  required_argument, 0, 'r'},
         {"interval",       required_argument, 0, 'i'},
         {"max-iter",       required_argument, 0, 'n'},
+        {"method",         required_argument, 0, 'M'},
+        {"thp",            required_argument, 0, OPT_THP},
+        {"cold",           no_argument,       0, OPT_COLD},
+        {"tier",           required_argument, 0, OPT_TIER},
+        {"manifest",       required_argument, 0, OPT_MANIFEST},
+        {"swapin",         no_argument,       0, OPT_SWAPIN},
+        {"order",          required_argument, 0, OPT_ORDER},
+        {"sample-access",  required_argument, 0, OPT_SAMPLE},
+        {"jobs",           required_argument, 0, 'j'},
+        {"cgroup",         required_argument, 0, OPT_CGROUP},
+        {"unit",           required_argument, 0, OPT_UNIT},
+        {"impact",         required_argument, 0, OPT_IMPACT},
+        {"impact-interval", required_argument, 0, OPT_IMPACT_INTERVAL},
+        {"probe",          required_argument, 0, OPT_PROBE},
+        {"node",           required_argument, 0, OPT_NODE},
+        {"tmpfs",          required_argument, 0, OPT_TMPFS},
+        {"park",           no_argument,       0, OPT_PARK},
+        {"unpark",         no_argument,       0, OPT_UNPARK},
+        {"wait-port",      required_argument, 0, OPT_WAIT_PORT},
+        {"parallel",       required_argument, 0, 'P'},
+        {"pool-idle",      required_argument, 0, OPT_POOL_IDLE},
+        {"gc",             no_argument,       0, OPT_GC},
+        {"recover",        no_argument,       0, OPT_RECOVER},
         {"quiet",          no_argument,       0, 'q'},
         {"help",           no_argument,       0, 'h'},
         {0,0,0,0}
@@ -373,26 +3916,151 @@ int main(int argc, char **argv) {
 
     int opt;
     int opt_index = 0;
-    while ((opt = getopt_long(argc, argv, "m:r:i:n:qh", long_opts, &opt_index)) != -1) {
+    while ((opt = getopt_long(argc, argv, "m:r:i:n:M:j:P:qh", long_opts, &opt_index)) != -1) {
         switch (opt) {
         case 'm':
-            limit_mb = strtol(optarg, NULL, 10);
-            if (limit_mb <= 0) limit_mb = 8;
+            o.limit_mb = strtol(optarg, NULL, 10);
+            if (o.limit_mb <= 0) o.limit_mb = 8;
             break;
         case 'r':
-            target_rss_kb = strtol(optarg, NULL, 10);
-            if (target_rss_kb <= 0) target_rss_kb = 16384;
+            o.target_rss_kb = strtol(optarg, NULL, 10);
+            if (o.target_rss_kb <= 0) o.target_rss_kb = 16384;
             break;
         case 'i':
-            interval = atof(optarg);
-            if (interval <= 0) interval = 1.0;
+            o.interval = atof(optarg);
+            if (o.interval <= 0) o.interval = 1.0;
             break;
         case 'n':
-            max_iter = atoi(optarg);
-            if (max_iter <= 0) max_iter = 60;
+            o.max_iter = atoi(optarg);
+            if (o.max_iter <= 0) o.max_iter = 60;
+            break;
+        case 'M':
+            if (strcmp(optarg, "clamp") == 0) {
+                o.method = METHOD_CLAMP;
+            } else if (strcmp(optarg, "madvise") == 0) {
+                o.method = METHOD_MADVISE;
+            } else if (strcmp(optarg, "cold") == 0) {
+                o.method = METHOD_COLD;
+            } else if (strcmp(optarg, "reclaim") == 0) {
+                o.method = METHOD_RECLAIM;
+            } else {
+                fprintf(stderr, "Unknown method '%s' (use clamp, madvise, cold or reclaim)\n",
+                        optarg);
+                return 1;
+            }
+            break;
+        case OPT_COLD:
+            o.method = METHOD_COLD;
+            break;
+        case OPT_TIER:
+            if (strcmp(optarg, "zswap") == 0) {
+                o.tier = TIER_ZSWAP;
+            } else if (strcmp(optarg, "disk") == 0) {
+                o.tier = TIER_DISK;
+            } else {
+                fprintf(stderr, "Unknown tier '%s' (use zswap or disk)\n", optarg);
+                return 1;
+            }
+            break;
+        case OPT_THP:
+            if (strcmp(optarg, "split") == 0) {
+                o.thp = THP_SPLIT;
+            } else if (strcmp(optarg, "cold") == 0) {
+                o.thp = THP_COLD;
+            } else if (strcmp(optarg, "skip") == 0) {
+                o.thp = THP_SKIP;
+            } else {
+                fprintf(stderr, "Unknown THP mode '%s' (use split, cold or skip)\n", optarg);
+                return 1;
+            }
+            break;
+        case OPT_MANIFEST:
+            o.manifest = optarg;
+            break;
+        case OPT_SWAPIN:
+            o.swapin = 1;
+            break;
+        case OPT_ORDER:
+            if (strcmp(optarg, "swap") == 0) {
+                o.order = ORDER_SWAP;
+            } else if (strcmp(optarg, "addr") == 0) {
+                o.order = ORDER_ADDR;
+            } else if (strcmp(optarg, "hot") == 0) {
+                o.order = ORDER_HOT;
+            } else {
+                fprintf(stderr, "Unknown order '%s' (use swap, addr or hot)\n", optarg);
+                return 1;
+            }
+            break;
+        case OPT_SAMPLE:
+            o.sample_secs = atof(optarg);
+            if (o.sample_secs < 0) o.sample_secs = 0;
+            break;
+        case OPT_CGROUP:
+            cgroup_arg = optarg;
+            break;
+        case OPT_UNIT:
+            unit_arg = optarg;
+            break;
+        case OPT_IMPACT:
+            o.impact = 1;
+            o.impact_window = atof(optarg);
+            if (o.impact_window < 0) o.impact_window = 0;
+            break;
+        case OPT_IMPACT_INTERVAL:
+            o.impact_interval = atof(optarg);
+            if (o.impact_interval <= 0) o.impact_interval = 0.25;
+            break;
+        case OPT_PROBE:
+            o.probe_cmd = optarg;
+            break;
+        case OPT_TMPFS:
+            tmpfs_arg = optarg;
+            break;
+        case OPT_PARK:
+            o.park = 1;
+            break;
+        case OPT_UNPARK:
+            o.unpark = 1;
+            break;
+        case OPT_WAIT_PORT:
+            for (char *tok = strtok(optarg, ","); tok; tok = strtok(NULL, ",")) {
+                int port = atoi(tok);
+                if (port <= 0 || port > 65535 ||
+                    o.nwait_ports >= (int)(sizeof(o.wait_ports) / sizeof(o.wait_ports[0]))) {
+                    fprintf(stderr, "Invalid or too many ports: %s\n", tok);
+                    return 1;
+                }
+                o.wait_ports[o.nwait_ports++] = port;
+            }
+            break;
+        case OPT_NODE:
+            o.node = atoi(optarg);
+            if (o.node < 0 || o.node >= NUMA_MAX_NODES || !numa_node_exists(o.node)) {
+                fprintf(stderr, "No such NUMA node: %s\n", optarg);
+                return 1;
+            }
+            break;
+        case 'j':
+            o.jobs = atoi(optarg);
+            if (o.jobs <= 0) o.jobs = 0;
+            break;
+        case 'P':
+            parallel = atoi(optarg);
+            if (parallel <= 0) parallel = 4;
+            break;
+        case OPT_POOL_IDLE:
+            pool_idle = strtol(optarg, NULL, 10);
+            if (pool_idle < 0) pool_idle = POOL_IDLE_SECS;
+            break;
+        case OPT_GC:
+            gc_only = 1;
+            break;
+        case OPT_RECOVER:
+            recover = 1;
             break;
         case 'q':
-            quiet = 1;
+            o.quiet = 1;
             break;
         case 'h':
         default:
@@ -401,86 +4069,116 @@ int main(int argc, char **argv) {
         }
     }
 
-    if (optind >= argc) {
-        fprintf(stderr, "Error: PID is required.\n\n");
-        usage(argv[0]);
-        return 1;
+    if (recover)
+        return journal_recover(o.quiet) ? 1 : 0;
+
+    if (gc_only) {
+        int removed = pool_gc(detect_cgroup_version(), pool_idle, o.quiet);
+        if (!o.quiet)
+            printf("[+] GC: %d group(s) removed\n", removed);
+        return 0;
     }
 
-    pid_t pid = (pid_t)atoi(argv[optind]);
-    if (pid <= 0) {
-        fprintf(stderr, "Invalid PID: %s\n", argv[optind]);
+    if ((o.park || o.unpark) && (!o.manifest || o.park + o.unpark + o.swapin > 1 ||
+                                 cgroup_arg || unit_arg || tmpfs_arg || o.node >= 0)) {
+        fprintf(stderr, "--park/--unpark need --manifest FILE and a PID, and exclude "
+                        "--swapin, --node and --cgroup/--unit/--tmpfs\n");
         return 1;
     }
-
-    /* Check that /proc/PID exists */
-    char proc_path[64];
-    snprintf(proc_path, sizeof(proc_path), "/proc/%d", pid);
-    if (!file_exists(proc_path)) {
-        fprintf(stderr, "No such process: %d\n", pid);
+    if (o.park && o.method != METHOD_CLAMP && o.method != METHOD_MADVISE) {
+        fprintf(stderr, "--park always pages out with process_madvise\n");
         return 1;
     }
-
-    if (!quiet) {
-        printf("[+] swapout: targeting PID %d\n", pid);
-        printf("[+] limit_mb=%ld, target_rss_kb=%ld, interval=%.2f, max_iter=%d\n",
-               limit_mb, target_rss_kb, interval, max_iter);
+    if (o.nwait_ports && !o.unpark) {
+        fprintf(stderr, "--wait-port needs --unpark\n");
+        return 1;
     }
 
-    cgroup_ctx_t ctx;
-    if (setup_cgroup_for_pid(pid, &ctx, quiet) != 0) {
-        fprintf(stderr, "Failed to set up cgroup for pid %d\n", pid);
+    if (o.probe_cmd && !o.impact) {
+        fprintf(stderr, "--probe needs --impact SECS\n");
         return 1;
     }
 
-    if (apply_low_limit(&ctx, limit_mb, quiet) != 0) {
-        restore_limit(&ctx, quiet);
-        cleanup_cgroup(&ctx, quiet);
+    if (o.node >= 0 && ((o.method != METHOD_MADVISE && o.method != METHOD_COLD) ||
+                        o.swapin || cgroup_arg || unit_arg)) {
+        fprintf(stderr, "--node needs --method madvise or cold on a PID: only "
+                        "process_madvise can pick pages by node.\n");
         return 1;
     }
 
-    /* Poll until RSS <= target_rss_kb or max_iter reached or process exits */
-    int iter = 0;
-    int done = 0;
-
-    if (!quiet)
-        printf("[+] Forcing swap... polling process memory usage\n");
+    if (tmpfs_arg) {
+        int rc = swapout_tmpfs(tmpfs_arg, &o);
+        pool_gc(detect_cgroup_version(), pool_idle, o.quiet);
+        return rc;
+    }
 
-    while (iter < max_iter) {
-        proc_meminfo_t mi;
-        if (read_proc_meminfo(pid, &mi) != 0) {
-            if (!quiet)
-                printf("[!] Process %d no longer exists, stopping.\n", pid);
-            done = 1;
-            break;
+    if (cgroup_arg || unit_arg) {
+        if (o.method != METHOD_CLAMP && o.method != METHOD_RECLAIM) {
+            fprintf(stderr, "--cgroup/--unit support the clamp and reclaim methods only\n");
+            return 1;
         }
-
-        if (!quiet) {
-            printf("  iter %2d: RSS=%ld kB, SWAP=%ld kB\n",
-                   iter + 1, mi.rss_kb, mi.swap_kb);
+        char dir[PATH_MAX];
+        if (unit_arg) {
+            if (resolve_unit(detect_cgroup_version(), unit_arg, dir, sizeof(dir)) != 0) {
+                fprintf(stderr, "No cgroup found for unit %s\n", unit_arg);
+                return 1;
+            }
+        } else if (cgroup_arg[0] == '/') {
+            snprintf(dir, sizeof(dir), "%s", cgroup_arg);
+        } else {
+            snprintf(dir, sizeof(dir), "%s/%s", cgroup_mount(detect_cgroup_version()), cgroup_arg);
         }
+        return swapout_group(dir, &o);
+    }
 
-        if (mi.rss_kb <= target_rss_kb) {
-            if (!quiet)
-                printf("[+] Target RSS reached (<= %ld kB), stopping.\n", target_rss_kb);
-            done = 1;
-            break;
-        }
+    if (o.method == METHOD_RECLAIM) {
+        fprintf(stderr, "--method reclaim needs --cgroup or --unit\n");
+        return 1;
+    }
 
-        iter++;
-        sleep_double(interval);
+    if (o.method == METHOD_CLAMP && o.thp == THP_SKIP) {
+        fprintf(stderr, "--thp skip needs --method madvise or cold: a cgroup clamp "
+                        "reclaims THP-backed memory like any other.\n");
+        return 1;
     }
 
-    if (!done && !quiet) {
-        printf("[!] max_iter reached without hitting target RSS; restoring anyway.\n");
+    if (o.tier != TIER_DEFAULT && o.method != METHOD_CLAMP) {
+        fprintf(stderr, "--tier applies to the clamp method's worker group only\n");
+        return 1;
     }
 
-    restore_limit(&ctx, quiet);
-    cleanup_cgroup(&ctx, quiet);
+    if (optind >= argc) {
+        fprintf(stderr, "Error: PID is required.\n\n");
+        usage(argv[0]);
+        return 1;
+    }
 
-    if (!quiet)
-        printf("[+] swapout complete.\n");
+    int npids = argc - optind;
+    pid_t *pids = calloc((size_t)npids, sizeof(pid_t));
+    if (!pids) {
+        perror("calloc");
+        return 1;
+    }
+    for (int i = 0; i < npids; i++) {
+        pids[i] = (pid_t)atoi(argv[optind + i]);
+        if (pids[i] <= 0) {
+            fprintf(stderr, "Invalid PID: %s\n", argv[optind + i]);
+            free(pids);
+            return 1;
+        }
+    }
 
-    return 0;
-}
+    int rc;
+    if (npids == 1) {
+        rc = run_target(pids[0], &o);
+    } else {
+        /* Keep interleaved output from concurrent children line-atomic */
+        setvbuf(stdout, NULL, _IOLBF, 0);
+        o.batch = 1;
+        rc = run_batch(pids, npids, parallel, &o);
+    }
+    free(pids);
 
+    pool_gc(detect_cgroup_version(), pool_idle, o.quiet);
+    return rc;
+}